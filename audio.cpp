@@ -1,68 +1,206 @@
 #include <audio.hpp>
 #include <cinttypes>
+#include <atomic>
+#include <iterator>
 #include <stdexcept>
 #include <aic23b.h>
 #include <i2s.h>
 #include <i2c.h>
+#include <profiler.hpp>
+#include <systime.hpp>
+#include <sample_convert.hpp>
 
 #ifndef AUDIO_BATCH_SIZE
 #error  AUDIO_BATCH_SIZE has to be defined!
 #endif
 
-#define AUDIO_BUFFER_SIZE (2 * AUDIO_BATCH_SIZE)
+#ifndef AUDIO_QUEUE_DEPTH
+#error  AUDIO_QUEUE_DEPTH has to be defined!
+#endif
+
+//! Marks DMA memory register pointing at audio_silence
+#define AUDIO_NO_PERIOD 0xffffffff
 
-//! The audio buffer - contains two audio batches
-static uint16_t audio_buffer[AUDIO_BUFFER_SIZE];
+/**
+	Output queue - a ring of audio periods. The DMA works in double buffer mode
+	and reads periods directly from here - one memory register points at the
+	period being played and the other one at the period to be played next.
+	A stereo frame takes one word in 16-bit mode and two words with longer samples (see sample_convert.hpp).
+*/
+static uint32_t audio_periods[AUDIO_MAX_QUEUE_DEPTH][AUDIO_BATCH_SIZE];
 
-//! Pointer to current back part of the audio buffer
-static volatile uint16_t *audio_back_buffer = nullptr;
+//! Played whenever the next period isn't ready on time
+static uint32_t audio_silence[AUDIO_BATCH_SIZE];
 
 /**
-	This flag is set whenever the audio engine is ready to accept new data.
-	It is set when DMA transfer finishes and it is cleared when audio_dispatch_*()
-	is called.
-	
-	If the flag is already set when DMA transfer finishes, it is considered a buffer underrun.
+	Input ring - periods captured from the codec's ADC by I2S2ext. The Rx DMA works
+	in double buffer mode just like the Tx one and both of them are driven by the same
+	I2S clocks, so captured period n covers exactly the same time as the n-th period
+	played. Captured period n is stored in audio_in_periods[n % AUDIO_INPUT_PERIODS].
+*/
+static uint32_t audio_in_periods[AUDIO_INPUT_PERIODS][AUDIO_BATCH_SIZE];
+
+//! Current length of stereo audio batch (period) - the DMA only uses first audio_batch_size samples of each period
+static int audio_batch_size = AUDIO_BATCH_SIZE;
+
+//! Output sample length in bits (16, 24 or 32)
+static int audio_word_length = AUDIO_WORD_LENGTH;
+
+//! Sample rate in Hz - generated by the codec (I2S master) from its master clock
+static int audio_sample_rate = AUDIO_SAMPLE_RATE;
+
+//! Number of periods in the queue (including the two used by the DMA)
+static int audio_queue_depth = AUDIO_QUEUE_DEPTH;
+
+//! Set while the DMA is running
+static bool audio_running = false;
+
+//! Output dither generator - dither is disabled if null
+static sample_dither audio_dither_state;
+static sample_dither *audio_dither = nullptr;
+
+/**
+	Period sequence numbers. Periods are written by audio_dispatch_*( ), handed
+	to the DMA and then released once they're played, always in the same order.
+	Period n is stored in audio_periods[n % audio_queue_depth].
 */
-volatile bool audio_ready_flag = false;
+static volatile uint32_t audio_written = 0;
+static volatile uint32_t audio_handed = 0;
+static volatile uint32_t audio_released = 0;
+
+//! Sequence numbers of periods in DMA memory registers M0AR and M1AR (or AUDIO_NO_PERIOD)
+static uint32_t audio_dma_period[2];
+
+//! Length of one period in systime ticks
+static uint32_t audio_period_ticks = 0;
+
+//! Number of DMA periods (slots) played and captured since audio_start( )
+static volatile uint32_t audio_played_slots = 0;
+static volatile uint32_t audio_captured_slots = 0;
+
+//! Period audio_anchor_period starts playing at audio_anchor_time in slot audio_anchor_slot - updated in the DMA interrupt
+static volatile uint32_t audio_anchor_period = 0;
+static volatile uint32_t audio_anchor_slot = 0;
+static volatile uint32_t audio_anchor_time = 0;
+
+//! systime_now( ) of the moment when each captured period was complete
+static volatile uint32_t audio_in_time[AUDIO_INPUT_PERIODS];
+
+//! Round-trip latency statistics (in frames) - from capture of an input sample to playback of the output it affected
+static int audio_latency_min = 0;
+static int audio_latency_max = 0;
+
+//! Queue level statistics - number of periods waiting for the DMA when it takes the next one
+static volatile int audio_queue_min = 0;
+static volatile int audio_queue_max = 0;
 
 //! Audio buffer underrun counter
 volatile int audio_underrun_counter = 0;
 
-//! Called when the DMA has finished transmitting the second half of the buffer
-void HAL_I2S_TxCpltCallback( I2S_HandleTypeDef *h )
+//! Number of input periods overwritten before audio_receive( ) could read them
+volatile int audio_input_overrun_counter = 0;
+
+//! Time spent converting samples in audio_dispatch_*() (without waiting for the DMA)
+static profiler_probe audio_dispatch_probe( "audio_dispatch" );
+
+//! Time spent converting samples in audio_receive() (without waiting for the DMA)
+static profiler_probe audio_receive_probe( "audio_receive" );
+
+/**
+	Called when the DMA has finished playing the period pointed by memory register m
+	and has switched to the other one. The next period is put in m.
+*/
+static void audio_dma_period_done( int m )
+{
+	uint32_t now = systime_now( );
+	uint32_t slot = ++audio_played_slots;
+	
+	// Periods are played in order, so the oldest one has just been released
+	if ( audio_dma_period[m] != AUDIO_NO_PERIOD ) audio_released++;
+	
+	int queued = audio_written - audio_handed;
+	if ( queued < audio_queue_min ) audio_queue_min = queued;
+	if ( queued > audio_queue_max ) audio_queue_max = queued;
+	
+	const uint32_t *next;
+	if ( queued )
+	{
+		next = audio_periods[audio_handed % audio_queue_depth];
+		audio_dma_period[m] = audio_handed;
+		audio_anchor_period = audio_handed;
+		audio_anchor_slot = slot + 1;
+		audio_anchor_time = now + audio_period_ticks;
+		audio_handed++;
+	}
+	else
+	{
+		next = audio_silence;
+		audio_dma_period[m] = AUDIO_NO_PERIOD;
+		audio_anchor_period = audio_handed;
+		audio_anchor_slot = slot + 2;
+		audio_anchor_time = now + 2 * audio_period_ticks;
+		audio_underrun_counter++;
+	}
+	
+	HAL_DMAEx_ChangeMemory( audio_i2s.hdmatx, reinterpret_cast<uintptr_t>( next ), m ? MEMORY1 : MEMORY0 );
+}
+
+//! Memory 0 transfer complete - the DMA is now playing period from M1AR
+static void audio_dma_m0_complete( DMA_HandleTypeDef *h )
 {
-	if ( audio_ready_flag ) audio_underrun_counter++;
-	audio_back_buffer = audio_buffer + AUDIO_BATCH_SIZE;
-	audio_ready_flag = true;
+	audio_dma_period_done( 0 );
 }
 
-//! Called when the DMA has finished transmitting the first half of the buffer
-void HAL_I2S_TxHalfCpltCallback( I2S_HandleTypeDef *h )
+//! Memory 1 transfer complete - the DMA is now playing period from M0AR
+static void audio_dma_m1_complete( DMA_HandleTypeDef *h )
 {
-	if ( audio_ready_flag ) audio_underrun_counter++;
-	audio_back_buffer = audio_buffer;
-	audio_ready_flag = true;
+	audio_dma_period_done( 1 );
 }
 
-//! I2S error handler
-void HAL_I2S_ErrorCallback( I2S_HandleTypeDef *h )
+/**
+	Called when the Rx DMA has filled memory register m and has switched to the other
+	one. Memory m is then pointed at the period to be captured after the current one.
+*/
+static void audio_rx_period_done( int m )
 {
-	while ( 1 ); //TODO
+	uint32_t slot = audio_captured_slots;
+	audio_in_time[slot % AUDIO_INPUT_PERIODS] = systime_now( );
+	audio_captured_slots = slot + 1;
+	
+	const uint32_t *next = audio_in_periods[( slot + 2 ) % AUDIO_INPUT_PERIODS];
+	HAL_DMAEx_ChangeMemory( audio_i2s.hdmarx, reinterpret_cast<uintptr_t>( next ), m ? MEMORY1 : MEMORY0 );
 }
 
-//! Clamps float data to specified range
-static inline float clamp( float x, float min, float max )
+static void audio_rx_m0_complete( DMA_HandleTypeDef *h )
 {
-	if ( x > max ) return max;
-	else if ( x < min ) return min;
-	else return x;
+	audio_rx_period_done( 0 );
 }
 
-//! Converts a float sample to uint16_t format required by DMA via int16_t in which the codec expects the data. Clamps float data as well.
-static inline uint16_t float_to_dma( float x )
+static void audio_rx_m1_complete( DMA_HandleTypeDef *h )
 {
-	return static_cast<uint16_t>( static_cast<int16_t>( 32767 * clamp( x, -1.f, 1.f ) ) );
+	audio_rx_period_done( 1 );
+}
+
+//! DMA error handler
+static void audio_dma_error( DMA_HandleTypeDef *h )
+{
+	while ( 1 ); //TODO
+}
+
+/**
+	Sleeps until there's a free period in the queue. Interrupts are masked while the
+	queue is checked, so the wake-up can't be missed (WFI returns on pending interrupts anyway).
+*/
+static inline void audio_wait_ready( )
+{
+	__disable_irq( );
+	while ( !audio_is_ready( ) )
+	{
+		__WFI( );
+		__enable_irq( );
+		__disable_irq( );
+	}
+	__enable_irq( );
 }
 
 /**
@@ -70,21 +208,113 @@ static inline uint16_t float_to_dma( float x )
 */
 bool audio_is_ready( )
 {
-	return audio_ready_flag;
+	return int( audio_written - audio_released ) < audio_queue_depth;
+}
+
+//! Returns the period to be filled by audio_dispatch_*( )
+static inline uint32_t *audio_back_buffer( )
+{
+	return audio_periods[audio_written % audio_queue_depth];
+}
+
+//! Puts the period returned by audio_back_buffer( ) in the queue
+static inline void audio_enqueue( )
+{
+	// The sample data has to be in memory before the interrupt can see the period
+	std::atomic_signal_fence( std::memory_order_release );
+	audio_written = audio_written + 1;
 }
 
 /**
-	Enqueues stereo float data for transmission. If some data has already been dispatched, blocks until current DMA transfer is complete.
-	Accepts pointer to float stereo audio buffer of length AUDIO_BATCH_SIZE
+	Enqueues stereo float data for transmission. Blocks if the queue is full.
+	Accepts pointer to float stereo audio buffer of length audio_get_stereo_batch_size( )
 */
 void audio_dispatch_stereo( const float *buf )
 {
-	// Wait for buffer swap if data has already been submitted
-	while ( !audio_ready_flag );
+	audio_wait_ready( );
+	profiler_scope scope( audio_dispatch_probe );
+	
+	if ( audio_word_length == 16 )
+		sample_convert_stereo( buf, audio_back_buffer( ), audio_batch_size / 2, audio_dither );
+	else
+		sample_convert_stereo_wide( buf, audio_back_buffer( ), audio_batch_size / 2, audio_word_length, audio_dither );
+	audio_enqueue( );
+}
+
+/**
+	Returns captured input for the period to be written next by audio_dispatch_*( ).
+	That's the input period captured exactly audio_get_queue_depth( ) periods before
+	the output period plays, so the round-trip latency is constant (and the same as MIDI latency).
+	Waits until the period is captured - it's normally complete by the time there's
+	room in the output queue.
+	
+	Fills count buffers of length audio_get_mono_batch_size( ) - one channel is a mix of
+	both inputs, two channels are left and right input. Further channels are silent.
+	Inputs are silent if the period was overwritten because the render loop was late.
+*/
+void audio_receive( float *const *channels, int count )
+{
+	int frames = audio_batch_size / 2;
+	uint32_t period, play_time;
+	if ( count <= 0 ) return;
+	
+	// Input slot aligned with the next output period (may change on underrun while waiting)
+	__disable_irq( );
+	while ( 1 )
+	{
+		period = audio_anchor_slot + ( audio_written - audio_anchor_period ) - audio_queue_depth;
+		if ( int32_t( audio_captured_slots - period ) > 0 ) break;
+		__WFI( );
+		__enable_irq( );
+		__disable_irq( );
+	}
+	play_time = audio_anchor_time + ( audio_written - audio_anchor_period ) * audio_period_ticks;
+	uint32_t capture_time = audio_in_time[period % AUDIO_INPUT_PERIODS];
+	__enable_irq( );
+	
+	profiler_scope scope( audio_receive_probe );
+	
+	for ( int i = 2; i < count; i++ )
+		std::memset( channels[i], 0, frames * sizeof( float ) );
+	
+	// Periods captured before the start are silent
+	bool valid = int32_t( period ) >= 0;
+	if ( valid )
+	{
+		sample_convert_input( audio_in_periods[period % AUDIO_INPUT_PERIODS], channels[0],
+			count > 1 ? channels[1] : nullptr, frames, audio_word_length );
+		
+		// The DMA might have started overwriting the period meanwhile
+		std::atomic_signal_fence( std::memory_order_acquire );
+		valid = int32_t( audio_captured_slots - period ) < AUDIO_INPUT_PERIODS - 1;
+		if ( !valid ) audio_input_overrun_counter++;
+	}
+	
+	if ( !valid )
+	{
+		for ( int i = 0; i < count && i < 2; i++ )
+			std::memset( channels[i], 0, frames * sizeof( float ) );
+		return;
+	}
 	
-	for ( int i = 0; i < AUDIO_BATCH_SIZE; i++ )
-		audio_back_buffer[i] = float_to_dma( buf[i] );
-	audio_ready_flag = false;
+	// The period started being captured one period before it was complete
+	int latency = uint64_t( play_time - capture_time + audio_period_ticks ) * audio_sample_rate / systime_ticks_per_second( );
+	if ( latency < audio_latency_min ) audio_latency_min = latency;
+	if ( latency > audio_latency_max ) audio_latency_max = latency;
+}
+
+/**
+	Returns lowest and highest measured round-trip latency (in frames) since the last call.
+	The latency is measured from capture of an input sample to playback of the output sample
+	computed from it (conversion delays of the codec are not included). Both values
+	are 0 if no input has been received.
+*/
+void audio_get_input_latency( int &min, int &max )
+{
+	min = audio_latency_min <= audio_latency_max ? audio_latency_min : 0;
+	max = audio_latency_max;
+	audio_latency_min = INT32_MAX;
+	audio_latency_max = 0;
 }
 
 /**
@@ -92,25 +322,23 @@ void audio_dispatch_stereo( const float *buf )
 */
 int audio_get_stereo_batch_size( )
 {
-	return AUDIO_BATCH_SIZE;
+	return audio_batch_size;
 }
 
 /**
-	Enqueues mono float data for transmission. If some data has already been dispatched, blocks until current DMA transfer is complete.
-	Accepts pointer to float mono audio buffer of length AUDIO_BATCH_SIZE/2
+	Enqueues mono float data for transmission. Blocks if the queue is full.
+	Accepts pointer to float mono audio buffer of length audio_get_mono_batch_size( )
 */
 void audio_dispatch_mono( const float *buf )
 {
-	// Wait for buffer swap if data has already been submitted
-	while ( !audio_ready_flag );
+	audio_wait_ready( );
+	profiler_scope scope( audio_dispatch_probe );
 	
-	for ( int i = 0; i < AUDIO_BATCH_SIZE / 2; i++ )
-	{
-		uint16_t sample = float_to_dma( buf[i] );
-		audio_back_buffer[2 * i] = sample;
-		audio_back_buffer[2 * i + 1] = sample;
-	}
-	audio_ready_flag = false;
+	if ( audio_word_length == 16 )
+		sample_convert_mono( buf, audio_back_buffer( ), audio_batch_size / 2, audio_dither );
+	else
+		sample_convert_mono_wide( buf, audio_back_buffer( ), audio_batch_size / 2, audio_word_length, audio_dither );
+	audio_enqueue( );
 }
 
 /**
@@ -118,32 +346,177 @@ void audio_dispatch_mono( const float *buf )
 */
 int audio_get_mono_batch_size( )
 {
-	return AUDIO_BATCH_SIZE / 2;
+	return audio_batch_size / 2;
+}
+
+/**
+	Changes length of mono audio batch (in frames). It has to be a power of two between
+	AUDIO_MIN_BATCH_SIZE / 2 and AUDIO_BATCH_SIZE / 2. If audio is running, the DMA is
+	restarted, which causes a short gap in the output.
+*/
+void audio_set_mono_batch_size( int size )
+{
+	if ( size < AUDIO_MIN_BATCH_SIZE / 2 || size > AUDIO_BATCH_SIZE / 2 || ( size & ( size - 1 ) ) )
+		throw std::runtime_error( "invalid audio batch size" );
+	
+	if ( 2 * size == audio_batch_size ) return;
+	
+	bool running = audio_running;
+	if ( running ) audio_stop( );
+	audio_batch_size = 2 * size;
+	if ( running ) audio_start( );
+}
+
+/**
+	Enables or disables TPDF dither added to the output before conversion to 16 bits
+*/
+void audio_set_dither( bool enable )
+{
+	audio_dither = enable ? &audio_dither_state : nullptr;
+}
+
+/**
+	Changes number of periods in the output queue (between 3 and AUDIO_MAX_QUEUE_DEPTH).
+	Two of them are always used by the DMA, so deeper queue lets the render loop get further
+	ahead and absorb longer compute spikes at the cost of latency. Restarts the DMA if audio is running.
+*/
+void audio_set_queue_depth( int depth )
+{
+	if ( depth < 3 || depth > AUDIO_MAX_QUEUE_DEPTH )
+		throw std::runtime_error( "invalid audio queue depth" );
+	
+	if ( depth == audio_queue_depth ) return;
+	
+	bool running = audio_running;
+	if ( running ) audio_stop( );
+	audio_queue_depth = depth;
+	if ( running ) audio_start( );
+}
+
+int audio_get_queue_depth( )
+{
+	return audio_queue_depth;
+}
+
+/**
+	Returns systime_now( ) of the moment when the period to be written next by
+	audio_dispatch_*( ) will start playing (assuming no underruns happen in between)
+*/
+uint32_t audio_get_next_period_time( )
+{
+	__disable_irq( );
+	uint32_t t = audio_anchor_time + ( audio_written - audio_anchor_period ) * audio_period_ticks;
+	__enable_irq( );
+	return t;
+}
+
+/**
+	Returns lowest and highest number of periods waiting in the queue since the last call.
+	Low values mean that the render loop barely keeps up - 0 is the last step before an underrun.
+*/
+void audio_get_queue_stats( int &min, int &max )
+{
+	__disable_irq( );
+	min = audio_queue_min;
+	max = audio_queue_max;
+	audio_queue_min = audio_queue_depth;
+	audio_queue_max = 0;
+	__enable_irq( );
+}
+
+/**
+	\brief Enables I2S in sync with the codec's WS signal
+	
+	This is actually quite important, because I2S slave mode on this F4 is fucked up - see: https://www.st.com/resource/en/errata_sheet/dm00037591.pdf
+	In this implementation, we simply wait for WS to be high and then *enable* (not init) the I2S peripheral.
+	Sometimes audio channels are swapped, but that's not a critical issue. At least, there's no more glitched audio.
+	To improve that, I2S clock counting algorithm could be used.
+*/
+static void audio_i2s_sync( )
+{
+	// Following sync method could also be replaced with counting 31 clk pulses
+	// I think that would reduce number of times when channels are swapped
+	// I2S2ext (receiver) is enabled together with I2S2, so both see the same frames
+	__disable_irq( );
+	audio_i2s.Instance->I2SCFGR &= ~SPI_I2SCFGR_I2SE;
+	I2SxEXT( audio_i2s.Instance )->I2SCFGR &= ~SPI_I2SCFGR_I2SE;
+	while ( HAL_GPIO_ReadPin( GPIOB, GPIO_PIN_12 ) != 0 ); // Wait for WS low
+	while ( HAL_GPIO_ReadPin( GPIOB, GPIO_PIN_12 ) == 0 ); // Wait for WS high
+	I2SxEXT( audio_i2s.Instance )->I2SCFGR |= SPI_I2SCFGR_I2SE;
+	audio_i2s.Instance->I2SCFGR |= SPI_I2SCFGR_I2SE;
+	__enable_irq( );
 }
 
 /**
-	Starts audio transmission
+	Starts audio transmission and capture. Both Tx DMA memory registers point at silence
+	at first, so the first dispatched period is played after two periods.
+	Both DMAs are started while I2S is disabled, so they begin with the same frame.
 */
 void audio_start( )
 {
-	// Clear the buffer
-	for ( int i = 0; i < AUDIO_BUFFER_SIZE; i++ )
-		audio_buffer[i] = 0;
+	audio_written = audio_handed = audio_released = 0;
+	audio_played_slots = audio_captured_slots = 0;
+	audio_dma_period[0] = audio_dma_period[1] = AUDIO_NO_PERIOD;
+	audio_queue_min = audio_queue_depth;
+	audio_queue_max = 0;
+	audio_latency_min = INT32_MAX;
+	audio_latency_max = 0;
+	audio_period_ticks = uint64_t( systime_ticks_per_second( ) ) * ( audio_batch_size / 2 ) / audio_sample_rate;
+	audio_anchor_period = 0;
+	audio_anchor_slot = 2;
+	audio_anchor_time = systime_now( ) + 2 * audio_period_ticks;
+	
+	uint32_t length = audio_word_length == 16 ? audio_batch_size : 2 * audio_batch_size; // In halfwords
+	SPI_TypeDef *ext = I2SxEXT( audio_i2s.Instance );
+	audio_i2s.Instance->I2SCFGR &= ~SPI_I2SCFGR_I2SE;
+	ext->I2SCFGR &= ~SPI_I2SCFGR_I2SE;
+	
+	// Start the DMAs in double buffer mode
+	DMA_HandleTypeDef *dma = audio_i2s.hdmatx;
+	dma->XferCpltCallback = audio_dma_m0_complete;
+	dma->XferM1CpltCallback = audio_dma_m1_complete;
+	dma->XferHalfCpltCallback = nullptr;
+	dma->XferErrorCallback = audio_dma_error;
+	HAL_DMAEx_MultiBufferStart_IT( dma,
+		reinterpret_cast<uintptr_t>( audio_silence ),
+		reinterpret_cast<uintptr_t>( &audio_i2s.Instance->DR ),
+		reinterpret_cast<uintptr_t>( audio_silence ),
+		length );
 	
-	// Back buffer is in the second half of the audio buffer at the start and it's ready to accept data
-	audio_back_buffer = audio_buffer + AUDIO_BATCH_SIZE;
-	audio_ready_flag = true;
+	dma = audio_i2s.hdmarx;
+	dma->XferCpltCallback = audio_rx_m0_complete;
+	dma->XferM1CpltCallback = audio_rx_m1_complete;
+	dma->XferHalfCpltCallback = nullptr;
+	dma->XferErrorCallback = audio_dma_error;
+	HAL_DMAEx_MultiBufferStart_IT( dma,
+		reinterpret_cast<uintptr_t>( &ext->DR ),
+		reinterpret_cast<uintptr_t>( audio_in_periods[0] ),
+		reinterpret_cast<uintptr_t>( audio_in_periods[1] ),
+		length );
 	
-	// Start the DMA
-	HAL_I2S_Transmit_DMA( &audio_i2s, const_cast<uint16_t*>( audio_buffer ), AUDIO_BUFFER_SIZE );
+	// Clear receiver overrun left from previous operation (by reading DR and then SR)
+	( void ) ext->DR;
+	( void ) ext->SR;
+	
+	audio_i2s.Instance->CR2 |= SPI_CR2_TXDMAEN;
+	ext->CR2 |= SPI_CR2_RXDMAEN;
+	audio_i2s_sync( );
+	audio_running = true;
 }
 
 /**
-	Stops audio transmission
+	Stops audio transmission and capture (and disables I2S)
 */
 void audio_stop( )
 {
-	HAL_I2S_DMAStop( &audio_i2s );
+	SPI_TypeDef *ext = I2SxEXT( audio_i2s.Instance );
+	audio_i2s.Instance->CR2 &= ~SPI_CR2_TXDMAEN;
+	ext->CR2 &= ~SPI_CR2_RXDMAEN;
+	HAL_DMA_Abort( audio_i2s.hdmatx );
+	HAL_DMA_Abort( audio_i2s.hdmarx );
+	audio_i2s.Instance->I2SCFGR &= ~SPI_I2SCFGR_I2SE;
+	ext->I2SCFGR &= ~SPI_I2SCFGR_I2SE;
+	audio_running = false;
 }
 
 /**
@@ -157,9 +530,90 @@ static void codec_write_reg( uint8_t addr, uint8_t reg, uint16_t data, int timeo
 	HAL_GPIO_WritePin( GPIOB, GPIO_PIN_8, GPIO_PIN_SET ); // Set CS high
 }
 
+/**
+	Sample rates available in the codec's normal mode and corresponding values of the sample
+	rate register. Each rate is only available with one master clock frequency (AUDIO_CODEC_MCLK),
+	256 * fs in the base oversampling rate mode.
+*/
+struct codec_sample_rate
+{
+	int mclk;
+	int rate;
+	uint16_t reg;
+};
+
+static constexpr codec_sample_rate codec_sample_rates[] =
+{
+	{12288000, 48000, 0},
+	{12288000, 32000, CODEC_SR_SR2 | CODEC_SR_SR1},
+	{12288000, 8000,  CODEC_SR_SR1 | CODEC_SR_SR0},
+	{12288000, 96000, CODEC_SR_SR2 | CODEC_SR_SR1 | CODEC_SR_SR0},
+	{11289600, 44100, CODEC_SR_SR3},
+	{11289600, 88200, CODEC_SR_SR3 | CODEC_SR_SR2 | CODEC_SR_SR1 | CODEC_SR_SR0},
+};
+
+//! Returns index of sample rate table entry for given rate or -1 if the rate can't be generated from AUDIO_CODEC_MCLK
+static constexpr int codec_find_sample_rate( int rate )
+{
+	for ( int i = 0; i < int( std::size( codec_sample_rates ) ); i++ )
+		if ( codec_sample_rates[i].mclk == AUDIO_CODEC_MCLK && codec_sample_rates[i].rate == rate )
+			return i;
+	return -1;
+}
+
+static_assert( codec_find_sample_rate( AUDIO_SAMPLE_RATE ) >= 0, "AUDIO_SAMPLE_RATE can't be generated from AUDIO_CODEC_MCLK" );
+
+//! Returns value of the codec's sample rate register for current sample rate
+static uint16_t codec_sample_rate_reg( )
+{
+	return CODEC_SR_NORMAL | codec_sample_rates[codec_find_sample_rate( audio_sample_rate )].reg;
+}
+
+//! Returns value of the codec's digital audio format register for current word length
+static uint16_t codec_format( )
+{
+	uint16_t len = CODEC_FMT_LEN16;
+	if ( audio_word_length == 24 ) len = CODEC_FMT_LEN24;
+	else if ( audio_word_length == 32 ) len = CODEC_FMT_LEN32;
+	return CODEC_FMT_MASTER | len | CODEC_FMT_I2S;
+}
+
+/**
+	Changes the codec's word length and sample rate. The digital interface has to be deactivated meanwhile.
+*/
+static void codec_set_format( )
+{
+	try
+	{
+		codec_write_reg( CODEC_ADDR, CODEC_REG_DIGITAL_IF_ACT, 0 );
+		codec_write_reg( CODEC_ADDR, CODEC_REG_DIGITAL_AUDIO_FMT, codec_format( ) );
+		codec_write_reg( CODEC_ADDR, CODEC_REG_SAMPLE_RATE, codec_sample_rate_reg( ) );
+		codec_write_reg( CODEC_ADDR, CODEC_REG_DIGITAL_IF_ACT, 1 );
+	}
+	catch ( ... )
+	{
+		throw std::runtime_error( "codec format change failed" );
+	}
+}
+
+/**
+	Sets I2S data length for current word length (both I2S2 and I2S2ext). Channels are always
+	32 bits long, because that's what the codec generates in master mode (16-bit samples are extended).
+	I2S has to be disabled.
+*/
+static void audio_i2s_set_format( )
+{
+	uint32_t datlen = 0;
+	if ( audio_word_length == 24 ) datlen = SPI_I2SCFGR_DATLEN_0;
+	else if ( audio_word_length == 32 ) datlen = SPI_I2SCFGR_DATLEN_1;
+	audio_i2s.Instance->I2SCFGR = ( audio_i2s.Instance->I2SCFGR & ~SPI_I2SCFGR_DATLEN ) | datlen | SPI_I2SCFGR_CHLEN;
+	
+	SPI_TypeDef *ext = I2SxEXT( audio_i2s.Instance );
+	ext->I2SCFGR = ( ext->I2SCFGR & ~SPI_I2SCFGR_DATLEN ) | datlen | SPI_I2SCFGR_CHLEN;
+}
+
 /**
 	Performs reset and initialization of TLV320AIC23B.
-	For now, the sampling rate is 48kHz.
 	\todo Improve codec init code
 */
 static void codec_init( )
@@ -172,8 +626,8 @@ static void codec_init( )
 		
 		codec_write_reg( CODEC_ADDR, CODEC_REG_DIGITAL_AUDIO_PATH, 0 );
 		codec_write_reg( CODEC_ADDR, CODEC_REG_POWER_DOWN, 0 );
-		codec_write_reg( CODEC_ADDR, CODEC_REG_DIGITAL_AUDIO_FMT, CODEC_FMT_MASTER | CODEC_FMT_LEN16 | CODEC_FMT_I2S );
-		codec_write_reg( CODEC_ADDR, CODEC_REG_SAMPLE_RATE, CODEC_SR_NORMAL ); //48kHz
+		codec_write_reg( CODEC_ADDR, CODEC_REG_DIGITAL_AUDIO_FMT, codec_format( ) );
+		codec_write_reg( CODEC_ADDR, CODEC_REG_SAMPLE_RATE, codec_sample_rate_reg( ) );
 		codec_write_reg( CODEC_ADDR, CODEC_REG_DIGITAL_IF_ACT, 1 );
 		HAL_Delay( 100 );
 	}
@@ -186,24 +640,62 @@ static void codec_init( )
 /**
 	\brief Initializes audio (codec + i2s)
 	
-	This is actually quite important, because I2S slave mode on this F4 is fucked up - see: https://www.st.com/resource/en/errata_sheet/dm00037591.pdf
-	In this implementation, we simply wait for WS to be high and then *enable* (not init) the I2S peripheral.
-	Sometimes audio channels are swapped, but that's not a critical issue. At least, there's no more glitched audio.
-	To improve that, I2S clock counting algorithm could be used.
-	
 	The batch_size argument determines DMA batch size in words
 */
 void audio_init( )
 {
 	codec_init( );
 	MX_I2S2_Init( ); // TODO replace with custom init (without i2s enable)
-	
-	// Following sync method could also be replaced with counting 31 clk pulses
-	// I think that would reduce number of times when channels are swapped
-	__disable_irq( );
 	audio_i2s.Instance->I2SCFGR &= ~SPI_I2SCFGR_I2SE;
-	while ( HAL_GPIO_ReadPin( GPIOB, GPIO_PIN_12 ) != 0 ); // Wait for WS low
-	while ( HAL_GPIO_ReadPin( GPIOB, GPIO_PIN_12 ) == 0 ); // Wait for WS high
-	audio_i2s.Instance->I2SCFGR |= SPI_I2SCFGR_I2SE;
-	__enable_irq( );
+	I2SxEXT( audio_i2s.Instance )->I2SCFGR &= ~SPI_I2SCFGR_I2SE;
+	audio_i2s_set_format( );
+}
+
+/**
+	Changes output sample length - 16, 24 or 32 bits. Both the codec and I2S are
+	reconfigured, so audio is restarted if it's running.
+*/
+void audio_set_word_length( int bits )
+{
+	if ( bits != 16 && bits != 24 && bits != 32 )
+		throw std::runtime_error( "invalid audio word length" );
+	
+	if ( bits == audio_word_length ) return;
+	
+	bool running = audio_running;
+	if ( running ) audio_stop( );
+	audio_word_length = bits;
+	codec_set_format( );
+	audio_i2s_set_format( );
+	if ( running ) audio_start( );
+}
+
+int audio_get_word_length( )
+{
+	return audio_word_length;
+}
+
+/**
+	Changes the sample rate. The codec generates I2S clocks, so it's the only thing
+	that has to be reprogrammed (the I2S slave just follows). Only rates which can be
+	derived from the codec's master clock (AUDIO_CODEC_MCLK) are accepted - 8, 32, 48 and 96 kHz
+	with 12.288 MHz and 44.1 and 88.2 kHz with 11.2896 MHz. Audio is restarted if it's running.
+*/
+void audio_set_sample_rate( int rate )
+{
+	if ( codec_find_sample_rate( rate ) < 0 )
+		throw std::runtime_error( "sample rate not supported with this codec master clock" );
+	
+	if ( rate == audio_sample_rate ) return;
+	
+	bool running = audio_running;
+	if ( running ) audio_stop( );
+	audio_sample_rate = rate;
+	codec_set_format( );
+	if ( running ) audio_start( );
+}
+
+int audio_get_sample_rate( )
+{
+	return audio_sample_rate;
 }
@@ -10,6 +10,7 @@ static I2S_HandleTypeDef &audio_i2s = hi2s2;
 
 // Audio buffers and pointers
 extern volatile int audio_underrun_counter;
+extern volatile int audio_input_overrun_counter;
 
 // Function prototypes
 extern void audio_init( );
@@ -20,9 +21,37 @@ extern void audio_dispatch_mono( const float *buf );
 extern int audio_get_mono_batch_size( );
 extern void audio_dispatch_stereo( const float *buf );
 extern int audio_get_stereo_batch_size( );
+extern void audio_set_mono_batch_size( int size );
+extern void audio_set_word_length( int bits );
+extern int audio_get_word_length( );
+extern void audio_set_sample_rate( int rate );
+extern int audio_get_sample_rate( );
+extern void audio_set_dither( bool enable );
+extern void audio_set_queue_depth( int depth );
+extern int audio_get_queue_depth( );
+extern uint32_t audio_get_next_period_time( );
+extern void audio_get_queue_stats( int &min, int &max );
+extern void audio_receive( float *const *channels, int count );
+extern void audio_get_input_latency( int &min, int &max );
 
 /** \TODO create audio namespace */
 
+//! Max and min length of stereo audio batch (in samples, i.e. twice the number of frames)
 #define AUDIO_BATCH_SIZE 512
+#define AUDIO_MIN_BATCH_SIZE 64
+
+//! Default output sample length in bits (16, 24 or 32)
+#define AUDIO_WORD_LENGTH 16
+
+//! Default sample rate and frequency of the codec's master clock (crystal), which determines available sample rates
+#define AUDIO_SAMPLE_RATE 48000
+#define AUDIO_CODEC_MCLK 12288000
+
+//! Default and max number of periods in the output queue
+#define AUDIO_QUEUE_DEPTH 3
+#define AUDIO_MAX_QUEUE_DEPTH 8
+
+//! Number of periods in the input ring - input is read one queue length after it's captured
+#define AUDIO_INPUT_PERIODS ( AUDIO_MAX_QUEUE_DEPTH + 2 )
 
 #endif
@@ -0,0 +1,72 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <chrono>
+#include <vector>
+#include <random>
+#include <cstdint>
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+// See sample_convert.hpp - warnings about AVX-512 intrinsics are tied to the first inclusion
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#include <x86intrin.h>
+#pragma GCC diagnostic pop
+#endif
+
+/**
+	\file bench.hpp
+	Tiny helpers shared by host benchmarks
+*/
+
+//! Prevents the compiler from optimizing away computations stored in memory pointed by p
+static inline void bench_clobber( const void *p )
+{
+	asm volatile( "" : : "g"( p ) : "memory" );
+}
+
+/**
+	Runs f( ) repeatedly for at least min_time seconds and returns the best time
+	of a single run in seconds.
+*/
+template <typename F>
+double bench_time( F f, double min_time = 0.2 )
+{
+	using clock = std::chrono::steady_clock;
+	double best = 1e9, total = 0;
+	int runs = 0;
+
+	while ( total < min_time || runs < 5 )
+	{
+		auto t0 = clock::now( );
+		f( );
+		double t = std::chrono::duration<double>( clock::now( ) - t0 ).count( );
+		if ( t < best ) best = t;
+		total += t;
+		runs++;
+	}
+
+	return best;
+}
+
+//! Time stamp counter on x86 (roughly CPU cycles), nanoseconds elsewhere
+static inline uint64_t bench_ticks( )
+{
+#if defined( __x86_64__ ) || defined( __i386__ )
+	return __rdtsc( );
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now( ).time_since_epoch( ) ).count( );
+#endif
+}
+
+//! Returns n uniformly distributed random floats in [a; b]
+static inline std::vector<float> bench_uniform( int n, float a, float b, unsigned seed = 1 )
+{
+	std::mt19937 gen( seed );
+	std::uniform_real_distribution<float> dist( a, b );
+	std::vector<float> v( n );
+	for ( auto &x : v ) x = dist( gen );
+	return v;
+}
+
+#endif
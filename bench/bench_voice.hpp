@@ -0,0 +1,62 @@
+#ifndef BENCH_VOICE_HPP
+#define BENCH_VOICE_HPP
+
+#include <faust_dsp.hpp>
+#include <cmath>
+
+/**
+	\file bench_voice.hpp
+	A single synth voice for voice_bank benchmarks - a filtered sawtooth with a linear
+	envelope, written like Faust output. Its oscillator and filter restart on every note.
+*/
+
+class bench_voice : public faust_dsp_base
+{
+public:
+	void metadata( Meta *m ) override {}
+	int getNumInputs( ) override {return 0;}
+	int getNumOutputs( ) override {return 1;}
+	void instanceConstants( int samplerate ) override {m_sample_rate = samplerate;}
+	void instanceResetUserInterface( ) override {m_cutoff = 0.5f; m_gate = 0; m_note = 60;}
+	void instanceClear( ) override {m_phase = m_lp = m_env = m_last_gate = 0;}
+	void init( int samplerate ) override {instanceInit( samplerate );}
+	void instanceInit( int samplerate ) override {instanceConstants( samplerate ); instanceResetUserInterface( ); instanceClear( );}
+	int getSampleRate( ) override {return m_sample_rate;}
+	bench_voice *clone( ) override {return new bench_voice;}
+
+	void buildUserInterface( UI *ui ) override
+	{
+		ui->addHorizontalSlider( "cutoff", &m_cutoff, 0.5f, 0, 1, 0.001f );
+		ui->addButton( "gate", &m_gate );
+		ui->addHorizontalSlider( "note", &m_note, 60, 0, 127, 1 );
+	}
+
+	void compute( int count, float **inputs, float **outputs ) override
+	{
+		float f = 440.f * std::exp( ( m_note - 69.f ) * 0.0577622650f ) / m_sample_rate;
+		float fc = 0.05f + 0.5f * m_cutoff;
+		float step = 1.f / ( 0.01f * m_sample_rate );
+		if ( m_gate > m_last_gate ) m_phase = m_lp = 0;
+		m_last_gate = m_gate;
+
+		for ( int i = 0; i < count; i++ )
+		{
+			m_phase += f;
+			m_phase -= std::floor( m_phase );
+			m_lp += fc * ( 2.f * m_phase - 1.f - m_lp );
+			m_env = std::fmin( std::fmax( m_env + ( m_gate > 0 ? step : -step ), 0.f ), 1.f );
+			outputs[0][i] = 0.25f * m_lp * m_env;
+		}
+	}
+
+private:
+	float m_cutoff, m_gate, m_note;
+	float m_phase, m_lp, m_env, m_last_gate;
+	int m_sample_rate;
+};
+
+// Controls in declaration order
+enum {CUTOFF, GATE, NOTE, CONTROL_COUNT};
+static const bool shared_controls[CONTROL_COUNT] = {true, false, false};
+
+#endif
@@ -0,0 +1,255 @@
+#include <bench.hpp>
+#include <control_map.hpp>
+#include <cstdio>
+#include <cmath>
+#include <vector>
+
+/**
+	\file control_map_bench.cpp
+	Checks control_map curves against double precision references and compares cost
+	of a control update with the previous update loop (linear only, one pointer pair
+	per control).
+
+	Smoothed controls have to reach the same values in the middle of each sub-block as
+	si.smoo running on every sample, and stop ramping once settled. The cost of smoothing
+	is compared with per-sample smoothing of panel.dsp's knobs as Faust generates it. Exits with non-zero status on failure.
+*/
+
+static const int lin_count = 8;
+static const int exp_count = 4;
+static const int step_count = 4;
+static const int control_count = lin_count + exp_count + step_count;
+static const int block_size = 256;
+static const int subblock_size = 16;
+
+// panel.dsp - 15 knobs, 13 of them smoothed
+static const int panel_knob_count = 15;
+static const int panel_smoothed_count = 13;
+
+//! Previous analog assignment
+struct legacy_assignment
+{
+	float *ptr;
+	float min, max;
+	volatile float *src;
+};
+
+struct control_desc
+{
+	faust_curve_type curve;
+	int src;
+	float min, max, step;
+};
+
+static double reference( const control_desc &c, double x )
+{
+	if ( c.curve == CURVE_EXP ) return c.min * std::pow( double( c.max ) / c.min, x );
+	if ( c.curve == CURVE_STEP ) return c.min + c.step * std::round( x * ( c.max - c.min ) / c.step );
+	return c.min + ( c.max - c.min ) * x;
+}
+
+//! Returns the best number of ticks per call of f( ) done count times
+template <typename F>
+static double ticks_per_call( F f, int count )
+{
+	double best = 1e30;
+	bench_time( [&]( )
+	{
+		uint64_t t0 = bench_ticks( );
+		f( );
+		double t = double( bench_ticks( ) - t0 ) / count;
+		if ( t < best ) best = t;
+	} );
+	return best;
+}
+
+int main( )
+{
+	int errors = 0;
+	static volatile float inputs[32];
+	float values[control_count];
+
+	// Controls added in mixed order - the map groups them by curve
+	std::vector<control_desc> desc;
+	for ( int i = 0; i < control_count; i++ )
+	{
+		int k = i % 4;
+		if ( k == 1 && i / 4 < exp_count ) desc.push_back( {CURVE_EXP, ( i * 7 ) % 32, 0.01f, 4.f, 0.001f} );
+		else if ( k == 3 && i / 4 < step_count ) desc.push_back( {CURVE_STEP, ( i * 7 ) % 32, -1.5f, 1.5f, 1.f} );
+		else desc.push_back( {CURVE_LINEAR, ( i * 7 ) % 32, -12.f, 12.f, 0.001f} );
+	}
+
+	control_map<control_count> map;
+	for ( int i = 0; i < control_count; i++ )
+		map.add( &values[i], desc[i].src, desc[i].curve, desc[i].min, desc[i].max, desc[i].step );
+
+	// Curves against references
+	auto x = bench_uniform( 1000 * 32, 0.f, 1.f );
+	double max_error[3] = {0, 0, 0};
+	for ( int n = 0; n < 1000; n++ )
+	{
+		for ( int i = 0; i < 32; i++ )
+			inputs[i] = x[n * 32 + i];
+		map.update( inputs, block_size );
+		map.apply( 0, block_size );
+		for ( int i = 0; i < control_count; i++ )
+		{
+			double ref = reference( desc[i], inputs[desc[i].src] );
+			double err = std::fabs( values[i] - ref ) / std::fmax( std::fabs( ref ), 1.0 );
+			max_error[desc[i].curve] = std::fmax( max_error[desc[i].curve], err );
+		}
+	}
+	std::printf( "max relative error: linear %g, exponential %g, stepped %g\n", max_error[0], max_error[1], max_error[2] );
+	errors += max_error[CURVE_LINEAR] > 1e-6;
+	errors += max_error[CURVE_EXP] > 1e-5;
+	errors += max_error[CURVE_STEP] > 1e-6;
+
+	// Both ends of the range
+	for ( int i = 0; i < 32; i++ ) inputs[i] = 0;
+	map.update( inputs, block_size );
+	map.apply( 0, block_size );
+	for ( int i = 0; i < control_count; i++ )
+		errors += std::fabs( values[i] - desc[i].min ) > 1e-5f * std::fmax( std::fabs( desc[i].min ), 1.f );
+	for ( int i = 0; i < 32; i++ ) inputs[i] = 1;
+	map.update( inputs, block_size );
+	map.apply( 0, block_size );
+	for ( int i = 0; i < control_count; i++ )
+		errors += std::fabs( values[i] - desc[i].max ) > 1e-5f * std::fmax( std::fabs( desc[i].max ), 1.f );
+
+	// Cost per control update (once per block)
+	const int rounds = 1000;
+	std::vector<legacy_assignment> legacy;
+	for ( int i = 0; i < control_count; i++ )
+		legacy.push_back( {&values[i], desc[i].min, desc[i].max, &inputs[desc[i].src]} );
+
+	double t_legacy = ticks_per_call( [&]( )
+	{
+		for ( int r = 0; r < rounds; r++ )
+		{
+			for ( const auto &a : legacy )
+				*a.ptr = a.min + ( a.max - a.min ) * *a.src;
+			bench_clobber( values );
+		}
+	}, rounds );
+	double t_map = ticks_per_call( [&]( )
+	{
+		for ( int r = 0; r < rounds; r++ )
+		{
+			map.update( inputs, block_size );
+			map.apply( 0, block_size );
+			bench_clobber( values );
+		}
+	}, rounds );
+
+	// The same controls, all linear
+	control_map<control_count> linear_map;
+	for ( int i = 0; i < control_count; i++ )
+		linear_map.add( &values[i], desc[i].src, CURVE_LINEAR, desc[i].min, desc[i].max, desc[i].step );
+	double t_linear = ticks_per_call( [&]( )
+	{
+		for ( int r = 0; r < rounds; r++ )
+		{
+			linear_map.update( inputs, block_size );
+			linear_map.apply( 0, block_size );
+			bench_clobber( values );
+		}
+	}, rounds );
+
+	// Step response of sub-block smoothing vs si.smoo on every sample
+	control_map<1> smoothed;
+	float value;
+	inputs[0] = 0;
+	smoothed.add( &value, 0, CURVE_LINEAR, 0, 1, 0.001f, true );
+	smoothed.update( inputs, block_size );
+	smoothed.apply( 0, block_size );
+	inputs[0] = 1;
+	double smoo = 0, last = 0, max_smooth_error = 0, max_step = 0;
+	for ( int n = 0; n < 20; n++ )
+	{
+		smoothed.update( inputs, block_size );
+		errors += !smoothed.ramping( );
+		for ( int pos = 0; pos < block_size; pos += subblock_size )
+		{
+			// The value set for a sub-block is where si.smoo is in its middle
+			smoothed.apply( pos, pos + subblock_size );
+			double middle = inputs[0] - ( inputs[0] - smoo ) * std::pow( double( control_map<1>::smooth_pole ), 0.5 * subblock_size );
+			max_smooth_error = std::fmax( max_smooth_error, std::fabs( value - middle ) );
+			max_step = std::fmax( max_step, std::fabs( value - last ) );
+			last = value;
+			for ( int i = 0; i < subblock_size; i++ )
+				smoo = ( 1 - control_map<1>::smooth_pole ) * inputs[0] + control_map<1>::smooth_pole * smoo;
+		}
+	}
+	for ( int n = 0; n < 100; n++ )
+		smoothed.update( inputs, block_size );
+	std::printf( "max difference from si.smoo in the middle of sub-blocks: %g\n", max_smooth_error );
+	std::printf( "largest step of a smoothed control: %g (%g with one value per block)\n", max_step,
+		1 - std::pow( control_map<1>::smooth_pole, block_size ) );
+	errors += max_smooth_error > 1e-4;
+	errors += max_step > 1 - std::pow( control_map<1>::smooth_pole, subblock_size );
+	errors += smoothed.ramping( );
+
+	// panel.dsp knobs - smoothed by control_map
+	control_map<panel_knob_count> panel;
+	float panel_values[panel_knob_count];
+	for ( int i = 0; i < panel_knob_count; i++ )
+		panel.add( &panel_values[i], i, i < 6 ? CURVE_EXP : CURVE_LINEAR, 0.01f, 4.f, 0.001f, i < panel_smoothed_count );
+	double t_block = ticks_per_call( [&]( )
+	{
+		for ( int r = 0; r < rounds; r++ )
+		{
+			panel.update( inputs, block_size );
+			panel.apply( 0, block_size );
+			bench_clobber( panel_values );
+		}
+	}, rounds );
+
+	// The same while the knobs are moving - set once per sub-block
+	double t_ramp = ticks_per_call( [&]( )
+	{
+		for ( int r = 0; r < rounds; r++ )
+		{
+			panel.update( inputs, block_size );
+			for ( int pos = 0; pos < block_size; pos += subblock_size )
+			{
+				panel.apply( pos, pos + subblock_size );
+				bench_clobber( panel_values );
+			}
+		}
+	}, rounds );
+
+	// The same knobs smoothed by si.smoo in the DSP - the smoothed value is used on every sample
+	static float out[block_size];
+	float state[panel_smoothed_count] = {0};
+	double t_sample = ticks_per_call( [&]( )
+	{
+		for ( int r = 0; r < rounds; r++ )
+		{
+			for ( int i = 0; i < block_size; i++ )
+			{
+				float sum = 0;
+				for ( int k = 0; k < panel_smoothed_count; k++ )
+				{
+					state[k] = ( 1 - control_map<1>::smooth_pole ) * panel_values[k] + control_map<1>::smooth_pole * state[k];
+					sum += state[k];
+				}
+				out[i] = sum;
+			}
+			bench_clobber( out );
+		}
+	}, rounds );
+
+	std::printf( "%d controls (%d linear, %d exponential, %d stepped)\n", control_count, lin_count, exp_count, step_count );
+	std::printf( "%-40s %10s\n", "", "t/update" );
+	std::printf( "%-40s %10.1f\n", "previous update (linear only)", t_legacy );
+	std::printf( "%-40s %10.1f\n", "control_map update (all linear)", t_linear );
+	std::printf( "%-40s %10.1f\n", "control_map update (mixed curves)", t_map );
+	std::printf( "\npanel.dsp, %d knobs, %d smoothed, %d frame block\n", panel_knob_count, panel_smoothed_count, block_size );
+	std::printf( "%-40s %10s\n", "", "t/block" );
+	std::printf( "%-40s %10.1f\n", "si.smoo on every sample", t_sample );
+	std::printf( "%-40s %10.1f\n", "control_map, settled (one value)", t_block );
+	std::printf( "%-40s %10.1f\n", "control_map, ramping (per sub-block)", t_ramp );
+	std::printf( "%-40s %10.1f\n", "saved while ramping", t_sample - t_ramp );
+
+	return errors != 0;
+}
@@ -0,0 +1,173 @@
+#include <bench.hpp>
+#include <decimator.hpp>
+#include <cstdio>
+#include <cmath>
+#include <vector>
+
+/**
+	\file decimator_bench.cpp
+	Measures cost of decimator.hpp filters (ticks per output sample) and checks them:
+	 - polyphase output has to match direct convolution with the full half-band filter,
+	 - passband (up to 20 kHz at 48 kHz output) has to be flat within 0.01 dB,
+	 - tones which would alias below 20 kHz have to be attenuated by at least 78 dB.
+	Exits with non-zero status on failure.
+*/
+
+static const int block_size = 256;
+static const int block_count = 64;
+static const double output_rate = 48000;
+
+//! Returns the best number of ticks per output sample of f( ) decimating all blocks
+template <typename F>
+static double ticks_per_sample( F f )
+{
+	double best = 1e30;
+	bench_time( [&]( )
+	{
+		uint64_t t0 = bench_ticks( );
+		f( );
+		double t = double( bench_ticks( ) - t0 ) / ( block_size * block_count );
+		if ( t < best ) best = t;
+	} );
+	return best;
+}
+
+//! Full impulse response of a half-band filter defined by its odd taps
+static std::vector<double> halfband_taps( const float *coeffs, int k )
+{
+	std::vector<double> h( 4 * k - 1, 0.0 );
+	int c = 2 * k - 1;
+	h[c] = 0.5;
+	for ( int i = 0; i < k; i++ )
+		h[c + 2 * i + 1] = h[c - 2 * i - 1] = coeffs[i];
+	return h;
+}
+
+//! Direct form decimation - every input sample goes through every tap, every other output is dropped
+static void direct_decimate( const std::vector<double> &h, const float *in, float *out, int count )
+{
+	for ( int n = 0; n < count; n++ )
+	{
+		double acc = 0;
+		for ( int j = 0; j < int( h.size( ) ); j++ )
+			if ( 2 * n - j >= 0 ) acc += h[j] * in[2 * n - j];
+		out[n] = acc;
+	}
+}
+
+/**
+	Decimates a sine of frequency f (Hz, at factor * output_rate) and returns amplitude
+	(in dB) of the output at frequency g (Hz, at output_rate). Transient is skipped
+	and a Hann window is applied before the single-bin DFT.
+*/
+static double tone_level( int factor, double f, double g )
+{
+	const int skip = 256, n = 8192;
+	std::vector<float> in( factor * ( skip + n ) ), out( skip + n );
+	for ( size_t i = 0; i < in.size( ); i++ )
+		in[i] = std::sin( 2 * M_PI * f * i / ( factor * output_rate ) );
+
+	decimator d;
+	d.set_factor( factor );
+	for ( int i = 0; i < skip + n; i += block_size )
+		d.process( in.data( ) + factor * i, out.data( ) + i, block_size );
+
+	double re = 0, im = 0, wsum = 0;
+	for ( int i = 0; i < n; i++ )
+	{
+		double w = 0.5 - 0.5 * std::cos( 2 * M_PI * i / n );
+		double ph = 2 * M_PI * g * i / output_rate;
+		re += w * out[skip + i] * std::cos( ph );
+		im += w * out[skip + i] * std::sin( ph );
+		wsum += w;
+	}
+	return 20 * std::log10( 2 * std::hypot( re, im ) / wsum + 1e-30 );
+}
+
+//! Frequency f sampled at any multiple of output_rate seen after decimation
+static double fold( double f )
+{
+	f = std::fmod( f, output_rate );
+	return f > output_rate / 2 ? output_rate - f : f;
+}
+
+/**
+	Checks passband flatness and attenuation of tones aliasing into the passband.
+	Returns number of failures.
+*/
+static int check_response( int factor )
+{
+	double ripple = 0;
+	for ( double f = 100; f <= 20000; f += 1990 )
+		ripple = std::fmax( ripple, std::fabs( tone_level( factor, f, f ) ) );
+
+	// Everything from 28 kHz up to the oversampled Nyquist frequency that folds below 20 kHz
+	double worst = -1000, worst_f = 0;
+	for ( double f = 28000; f < factor * output_rate / 2; f += 250 )
+	{
+		double g = fold( f );
+		if ( g > 20000 ) continue;
+		double level = tone_level( factor, f, g );
+		if ( level > worst )
+		{
+			worst = level;
+			worst_f = f;
+		}
+	}
+
+	std::printf( "%dx: passband ripple %.4f dB, worst alias %.1f dB (%.0f Hz -> %.0f Hz)\n",
+		factor, ripple, worst, worst_f, fold( worst_f ) );
+	return ( ripple > 0.01 ) + ( worst > -78 );
+}
+
+int main( )
+{
+	const int n = block_size * block_count;
+	int errors = 0;
+
+	auto in = bench_uniform( 4 * n, -1.f, 1.f );
+	std::vector<float> out( n ), ref( n );
+	auto h63 = halfband_taps( halfband_coeffs_63, 16 );
+
+	decimator d2, d4;
+	d2.set_factor( 2 );
+	d4.set_factor( 4 );
+
+	std::printf( "%-24s %12s\n", "decimator", "t/out sample" );
+	double td = ticks_per_sample( [&]( )
+	{
+		for ( int i = 0; i < n; i += block_size )
+			direct_decimate( h63, in.data( ) + 2 * i, ref.data( ) + i, block_size );
+		bench_clobber( ref.data( ) );
+	} );
+	std::printf( "%-24s %12.2f\n", "2x direct form (double)", td );
+	double t2 = ticks_per_sample( [&]( )
+	{
+		for ( int i = 0; i < n; i += block_size )
+			d2.process( in.data( ) + 2 * i, out.data( ) + i, block_size );
+		bench_clobber( out.data( ) );
+	} );
+	std::printf( "%-24s %12.2f\n", "2x polyphase", t2 );
+	double t4 = ticks_per_sample( [&]( )
+	{
+		for ( int i = 0; i < n; i += block_size )
+			d4.process( in.data( ) + 4 * i, out.data( ) + i, block_size );
+		bench_clobber( out.data( ) );
+	} );
+	std::printf( "%-24s %12.2f\n", "4x two-stage polyphase", t4 );
+
+	// Polyphase form has to give the same result as direct convolution
+	d2.set_factor( 2 );
+	d2.process( in.data( ), out.data( ), n );
+	direct_decimate( h63, in.data( ), ref.data( ), n );
+	double max_diff = 0;
+	for ( int i = 0; i < n; i++ )
+		max_diff = std::fmax( max_diff, std::fabs( out[i] - ref[i] ) );
+	std::printf( "max difference from direct form: %g\n", max_diff );
+	errors += max_diff > 1e-5;
+
+	errors += check_response( 2 );
+	errors += check_response( 4 );
+
+	return errors != 0;
+}
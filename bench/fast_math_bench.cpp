@@ -0,0 +1,108 @@
+#include <bench.hpp>
+#include <fast_math.hpp>
+#include <cstdio>
+#include <cmath>
+
+/**
+	\file fast_math_bench.cpp
+	Sweeps every approximation from fast_math.hpp over its domain and prints
+	a CSV with max/RMS error against double precision libm and time per call.
+
+	Error is absolute where |f(x)| <= 1 and relative elsewhere, so functions
+	with large values (exp, tan near pi/2) are compared fairly.
+
+	Usage: fast_math_bench [output.csv] (defaults to stdout)
+*/
+
+//! Number of evenly spaced points used for error measurement
+static const int error_points = 1 << 20;
+
+//! Number of random arguments used for timing
+static const int timing_points = 1 << 14;
+
+static FILE *csv;
+
+//! Wraps f in a lambda, so it gets inlined into the timing loop like in Faust code
+#define BENCH_FUNCTION( name, a, b, f, libm ) \
+	bench_function( name, a, b, []( float x ) { return f( x ); }, libm )
+
+template <typename F, typename L>
+static void bench_function( const char *name, double a, double b, F f, L libm )
+{
+	// Error over a uniform grid including both ends of the domain
+	double max_error = 0, sum_sq = 0, worst_x = a;
+	for ( int i = 0; i < error_points; i++ )
+	{
+		float x = a + ( b - a ) * i / ( error_points - 1 );
+		double ref = libm( double( x ) );
+		double scale = std::fabs( ref ) > 1.0 ? std::fabs( ref ) : 1.0;
+		double e = std::fabs( f( x ) - ref ) / scale;
+		if ( !( e <= max_error ) ) max_error = e, worst_x = x; // Catches NaN as well
+		sum_sq += e * e;
+	}
+
+	// Throughput on random arguments, so the branch predictor doesn't learn the pattern
+	auto x = bench_uniform( timing_points, a, b );
+	std::vector<float> y( timing_points );
+	double t = bench_time( [&]( )
+	{
+		for ( int i = 0; i < timing_points; i++ )
+			y[i] = f( x[i] );
+		bench_clobber( y.data( ) );
+	} );
+	double tl = bench_time( [&]( )
+	{
+		for ( int i = 0; i < timing_points; i++ )
+			y[i] = libm( x[i] );
+		bench_clobber( y.data( ) );
+	} );
+
+	std::fprintf( csv, "%s,%g,%g,%.4g,%.4g,%.6g,%.3f,%.3f\n", name, a, b,
+		max_error, std::sqrt( sum_sq / error_points ), worst_x,
+		t / timing_points * 1e9, tl / timing_points * 1e9 );
+}
+
+int main( int argc, char *argv[] )
+{
+	csv = stdout;
+	if ( argc > 1 && !( csv = std::fopen( argv[1], "w" ) ) )
+	{
+		std::perror( argv[1] );
+		return 1;
+	}
+
+	auto lexp = []( auto x ) { return std::exp( x ); };
+	auto llog = []( auto x ) { return std::log( x ); };
+	auto llog2 = []( auto x ) { return std::log2( x ); };
+	auto ltan = []( auto x ) { return std::tan( x ); };
+	auto lsin = []( auto x ) { return std::sin( x ); };
+
+	// Stay away from the pole - fast_tanf_lookup( ) would also read past the LUT there
+	const double tan_max = M_PI / 2 - 0.01;
+
+	std::fprintf( csv, "function,domain_min,domain_max,max_error,rms_error,worst_x,ns_per_call,libm_ns_per_call\n" );
+
+	BENCH_FUNCTION( "taylor_exp5", -0.5, 0.5, taylor_exp5, lexp );
+	BENCH_FUNCTION( "taylor_exp5_2", 0, 1, taylor_exp5_2, lexp );
+	BENCH_FUNCTION( "taylor_exp5_sage", 0, 1, taylor_exp5_sage, lexp );
+	BENCH_FUNCTION( "fast_expf_lut_taylor", -20, 20, fast_expf_lut_taylor, lexp );
+	BENCH_FUNCTION( "fast_expf", -20, 20, fast_expf, lexp );
+
+	BENCH_FUNCTION( "fast_log2f_taylor_manual", 1, 2, fast_log2f_taylor_manual, llog2 );
+	BENCH_FUNCTION( "fast_log2f_taylor", 1, 2, fast_log2f_taylor, llog2 );
+	BENCH_FUNCTION( "fast_logf_taylor", 1, 2, fast_logf_taylor, llog );
+	BENCH_FUNCTION( "fast_log2f", 1e-3, 1e3, fast_log2f, llog2 );
+	BENCH_FUNCTION( "fast_logf", 1e-3, 1e3, fast_logf, llog );
+
+	BENCH_FUNCTION( "fast_tanf_hybrid", 0, tan_max, fast_tanf_hybrid, ltan );
+	BENCH_FUNCTION( "fast_tanf_lookup", 0, tan_max, fast_tanf_lookup, ltan );
+	BENCH_FUNCTION( "fast_tanf_pade", 0, tan_max, fast_tanf_pade, ltan );
+	BENCH_FUNCTION( "fast_tanf_pade(neg)", -tan_max, 0, fast_tanf_pade, ltan );
+	BENCH_FUNCTION( "fast_tanf", 0, tan_max, fast_tanf, ltan );
+
+	BENCH_FUNCTION( "fast_sinf_chebyshev", 0, M_PI / 2, fast_sinf_chebyshev, lsin );
+	BENCH_FUNCTION( "fast_sinf", -20, 20, fast_sinf, lsin );
+
+	if ( csv != stdout ) std::fclose( csv );
+	return 0;
+}
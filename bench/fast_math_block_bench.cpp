@@ -0,0 +1,87 @@
+#include <bench.hpp>
+#include <fast_math_block.hpp>
+#include <cstdio>
+#include <cmath>
+
+/**
+	\file fast_math_block_bench.cpp
+	Compares throughput of block functions from fast_math_block.hpp against
+	scalar fast_math.hpp functions called in a loop and against libm.
+*/
+
+static const int block_size = 256;
+static const int block_count = 64;
+
+template <typename S, typename B, typename L>
+static void bench_function( const char *name, float a, float b, S scalar, B block, L libm )
+{
+	const int n = block_size * block_count;
+	auto x = bench_uniform( n, a, b );
+	std::vector<float> ys( n ), yb( n ), yl( n );
+
+	double ts = bench_time( [&]( )
+	{
+		for ( int i = 0; i < n; i++ )
+			ys[i] = scalar( x[i] );
+		bench_clobber( ys.data( ) );
+	} );
+
+	double tb = bench_time( [&]( )
+	{
+		for ( int i = 0; i < n; i += block_size )
+			block( x.data( ) + i, yb.data( ) + i, block_size );
+		bench_clobber( yb.data( ) );
+	} );
+
+	double tl = bench_time( [&]( )
+	{
+		for ( int i = 0; i < n; i++ )
+			yl[i] = libm( x[i] );
+		bench_clobber( yl.data( ) );
+	} );
+
+	// Max relative error of block and scalar versions against libm
+	double eb = 0, es = 0;
+	for ( int i = 0; i < n; i++ )
+	{
+		double ref = libm( double( x[i] ) );
+		double scale = std::fabs( ref ) > 1.0 ? std::fabs( ref ) : 1.0;
+		eb = std::fmax( eb, std::fabs( yb[i] - ref ) / scale );
+		es = std::fmax( es, std::fabs( ys[i] - ref ) / scale );
+	}
+
+	std::printf( "%-8s %12.1f %12.1f %12.1f %10.2fx %12.3g %12.3g\n", name,
+		n / ts * 1e-6, n / tb * 1e-6, n / tl * 1e-6, ts / tb, es, eb );
+}
+
+int main( )
+{
+	std::printf( "%-8s %12s %12s %12s %11s %12s %12s\n", "function", "scalar S/us", "block S/us", "libm S/us", "speedup", "scalar err", "block err" );
+
+	bench_function( "exp", -10.f, 10.f,
+		[]( float x ) { return fast_expf( x ); },
+		fast_expf_block,
+		[]( auto x ) { return std::exp( x ); } );
+
+	bench_function( "log2", 1e-3f, 1e3f,
+		[]( float x ) { return fast_log2f( x ); },
+		fast_log2f_block,
+		[]( auto x ) { return std::log2( x ); } );
+
+	bench_function( "log", 1e-3f, 1e3f,
+		[]( float x ) { return fast_logf( x ); },
+		fast_logf_block,
+		[]( auto x ) { return std::log( x ); } );
+
+	bench_function( "tan", 0.f, 1.f,
+		[]( float x ) { return fast_tanf( x ); },
+		fast_tanf_block,
+		[]( auto x ) { return std::tan( x ); } );
+
+	bench_function( "sin", -20.f, 20.f,
+		[]( float x ) { return fast_sinf( x ); },
+		fast_sinf_block,
+		[]( auto x ) { return std::sin( x ); } );
+
+	return 0;
+}
@@ -0,0 +1,240 @@
+#include <bench.hpp>
+#include <faust_dsp.hpp>
+#include <unordered_map>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+/**
+	\file faust_controls_bench.cpp
+	Compares faust_control_table with the previous control storage (a map from
+	value pointer to a struct with std::string name and its own metadata map, and
+	a linear name lookup with string comparisons):
+	 - heap bytes and number of allocations held after building the UI,
+	 - ticks per lookup by name (hits and misses).
+	Both have to find the same controls and metadata. Exits with non-zero status on failure.
+*/
+
+// All heap allocations go through these, so live bytes can be measured (not inlined,
+// otherwise GCC sees free( ) called on a pointer from operator new)
+static size_t heap_bytes = 0;
+static size_t heap_blocks = 0;
+
+__attribute__( ( noinline ) ) void *operator new( size_t size )
+{
+	size_t *p = static_cast<size_t*>( std::malloc( size + sizeof( max_align_t ) ) );
+	if ( p == nullptr ) throw std::bad_alloc( );
+	*p = size;
+	heap_bytes += size;
+	heap_blocks++;
+	return reinterpret_cast<char*>( p ) + sizeof( max_align_t );
+}
+
+__attribute__( ( noinline ) ) void operator delete( void *ptr ) noexcept
+{
+	if ( ptr == nullptr ) return;
+	size_t *p = reinterpret_cast<size_t*>( static_cast<char*>( ptr ) - sizeof( max_align_t ) );
+	heap_bytes -= *p;
+	heap_blocks--;
+	std::free( p );
+}
+
+void operator delete( void *ptr, size_t ) noexcept
+{
+	operator delete( ptr );
+}
+
+/**
+	Previous implementation of control storage
+*/
+struct legacy_control
+{
+	std::string name;
+	float *ptr;
+	float min, max, def, step;
+	std::unordered_map<cstring, cstring> metadata;
+};
+
+struct legacy_ui
+{
+	void add( const char *name, float *ptr, float def, float min, float max, float step )
+	{
+		auto &ctl = controls[ptr];
+		ctl.name = name;
+		ctl.ptr  = ptr;
+		ctl.min  = min;
+		ctl.max  = max;
+		ctl.def  = def;
+		ctl.step = step;
+	}
+
+	void declare( float *ptr, const char *key, const char *value )
+	{
+		controls[ptr].metadata[key] = value;
+	}
+
+	const legacy_control *get_control_by_name( const cstring &name ) const
+	{
+		for ( const auto &[ptr, ctl] : controls )
+			if ( ctl.name == name.c_str( ) )
+				return &ctl;
+		return nullptr;
+	}
+
+	std::unordered_map<float*, legacy_control> controls;
+};
+
+// A DSP shaped like a bigger polyphonic patch - per-voice controls and panel parameters mapped to analog inputs
+static const int voice_count = 8;
+static const int param_count = 40;
+static const int control_count = 3 * voice_count + param_count;
+static char names[control_count][16];
+static float values[control_count];
+
+//! Makes the same calls Faust generated code would make
+template <typename T>
+static void build_ui( T &ui )
+{
+	static const char *const pins[] = {"a2", "a3", "a4", "a5", "b2", "b3", "b4", "b5"};
+	int n = 0;
+	for ( int i = 0; i < param_count; i++, n++ )
+	{
+		std::snprintf( names[n], sizeof names[n], "param%d", i );
+		ui.declare( &values[n], "analog", pins[i % 8] );
+		if ( i % 4 == 0 ) ui.declare( &values[n], "unit", "Hz" );
+		ui.add( names[n], &values[n], 0.5f, 0.f, 1.f, 0.001f );
+	}
+	for ( int i = 0; i < voice_count; i++ )
+	{
+		std::snprintf( names[n], sizeof names[n], "note_%d", i );
+		ui.add( names[n], &values[n], 0.f, 0.f, 127.f, 1.f );
+		n++;
+		std::snprintf( names[n], sizeof names[n], "gain_%d", i );
+		ui.add( names[n], &values[n], 0.f, 0.f, 1.f, 0.001f );
+		n++;
+		std::snprintf( names[n], sizeof names[n], "gate_%d", i );
+		ui.add( names[n], &values[n], 0.f, 0.f, 1.f, 1.f );
+		n++;
+	}
+
+	// Box metadata is declared with a null pointer
+	ui.declare( nullptr, "tooltip", "panel" );
+}
+
+//! Adapts faust_control_table to the calls above
+struct table_ui
+{
+	void add( const char *name, float *ptr, float def, float min, float max, float step )
+	{
+		table.add( CONTROL_SLIDER, name, ptr, def, min, max, step );
+	}
+
+	void declare( float *ptr, const char *key, const char *value )
+	{
+		table.declare( ptr, key, value );
+	}
+
+	faust_control_table table;
+};
+
+//! Returns the best number of ticks per single call of f( ) done count times
+template <typename F>
+static double ticks_per_call( F f, int count )
+{
+	double best = 1e30;
+	bench_time( [&]( )
+	{
+		uint64_t t0 = bench_ticks( );
+		f( );
+		double t = double( bench_ticks( ) - t0 ) / count;
+		if ( t < best ) best = t;
+	} );
+	return best;
+}
+
+int main( )
+{
+	int errors = 0;
+
+	size_t bytes0 = heap_bytes, blocks0 = heap_blocks;
+	auto *legacy = new legacy_ui;
+	build_ui( *legacy );
+	size_t legacy_bytes = heap_bytes - bytes0, legacy_blocks = heap_blocks - blocks0;
+
+	bytes0 = heap_bytes, blocks0 = heap_blocks;
+	auto *flat = new table_ui;
+	build_ui( *flat );
+	flat->table.build( );
+	size_t flat_bytes = heap_bytes - bytes0, flat_blocks = heap_blocks - blocks0;
+	const faust_control_table &table = flat->table;
+
+	// Both have to give the same controls with the same metadata
+	for ( int i = 0; i < control_count; i++ )
+	{
+		const legacy_control *ctl = legacy->get_control_by_name( names[i] );
+		int index = table.find( names[i] );
+		if ( ctl == nullptr || index < 0 || ctl->ptr != table.get_ptr( index ) || ctl->max != table.get_max( index ) )
+		{
+			std::printf( "control %s mismatch\n", names[i] );
+			errors++;
+			continue;
+		}
+		if ( int( ctl->metadata.size( ) ) != table.metadata_end( index ) - table.metadata_begin( index ) )
+			errors++;
+		for ( const auto &[k, v] : ctl->metadata )
+			if ( !( table.get_metadata( index, k ) == v ) )
+				errors++;
+	}
+	errors += table.size( ) != control_count;
+	errors += table.find( "note_8" ) != -1;
+	errors += table.find( "" ) != -1;
+
+	std::printf( "%d controls, %d with metadata\n", control_count, param_count );
+	std::printf( "%-12s %12s %12s %14s %14s\n", "storage", "heap bytes", "allocations", "t/lookup hit", "t/lookup miss" );
+
+	static const char *const misses[] = {"note_9", "gate_12", "paramx", "volume"};
+	const int miss_count = sizeof misses / sizeof misses[0];
+	const int rounds = 64;
+
+	float sum = 0;
+	double legacy_hit = ticks_per_call( [&]( )
+	{
+		for ( int r = 0; r < rounds; r++ )
+			for ( int i = 0; i < control_count; i++ )
+				sum += *legacy->get_control_by_name( names[i] )->ptr;
+		bench_clobber( &sum );
+	}, rounds * control_count );
+	double legacy_miss = ticks_per_call( [&]( )
+	{
+		for ( int r = 0; r < rounds; r++ )
+			for ( int i = 0; i < miss_count; i++ )
+				sum += legacy->get_control_by_name( misses[i] ) != nullptr;
+		bench_clobber( &sum );
+	}, rounds * miss_count );
+	std::printf( "%-12s %12zu %12zu %14.1f %14.1f\n", "legacy map", legacy_bytes, legacy_blocks, legacy_hit, legacy_miss );
+
+	double flat_hit = ticks_per_call( [&]( )
+	{
+		for ( int r = 0; r < rounds; r++ )
+			for ( int i = 0; i < control_count; i++ )
+				sum += *table.get_ptr( table.find( names[i] ) );
+		bench_clobber( &sum );
+	}, rounds * control_count );
+	double flat_miss = ticks_per_call( [&]( )
+	{
+		for ( int r = 0; r < rounds; r++ )
+			for ( int i = 0; i < miss_count; i++ )
+				sum += table.find( misses[i] ) >= 0;
+		bench_clobber( &sum );
+	}, rounds * miss_count );
+	std::printf( "%-12s %12zu %12zu %14.1f %14.1f\n", "flat table", flat_bytes, flat_blocks, flat_hit, flat_miss );
+
+	// Heap bytes above include the table object itself
+	errors += table.get_heap_size( ) + sizeof( table_ui ) != flat_bytes;
+	errors += flat_bytes >= legacy_bytes;
+
+	delete legacy;
+	delete flat;
+	return errors != 0;
+}
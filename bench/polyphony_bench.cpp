@@ -0,0 +1,192 @@
+#include <bench.hpp>
+#include <voice_allocator.hpp>
+#include <cstdio>
+#include <deque>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+/**
+	\file polyphony_bench.cpp
+	Checks voice_allocator against the previous deque based polyphony_controller
+	algorithm on random MIDI event streams and compares their event rates at 4, 16
+	and 64 voices.
+
+	After every event the key-voice map has to be consistent (check_invariants( ))
+	and both allocators have to pick the same voices. Exits with non-zero status on
+	failure.
+*/
+
+static const int event_count = 1 << 16;
+
+//! Previous algorithm - with idle voices initialized once and reset( ) forgetting all keys
+class legacy_allocator
+{
+public:
+	explicit legacy_allocator( int n ) :
+		m_voice_key( n, -1 )
+	{
+		reset( );
+	}
+
+	void reset( )
+	{
+		m_idle.clear( );
+		m_busy.clear( );
+		for ( int i = 0; i < int( m_voice_key.size( ) ); i++ )
+		{
+			m_idle.push_back( i );
+			m_voice_key[i] = -1;
+		}
+		for ( auto &v : m_key_voice ) v = -1;
+	}
+
+	int note_on( int key )
+	{
+		note_off( key );
+
+		int id;
+		if ( m_idle.size( ) )
+		{
+			id = m_idle.front( );
+			m_idle.pop_front( );
+		}
+		else
+		{
+			id = m_busy.front( );
+			m_busy.pop_front( );
+			m_key_voice[m_voice_key[id]] = -1;
+		}
+
+		m_busy.push_back( id );
+		m_key_voice[key] = id;
+		m_voice_key[id] = key;
+		return id;
+	}
+
+	int note_off( int key )
+	{
+		int id = m_key_voice[key];
+		m_key_voice[key] = -1;
+		if ( id < 0 ) return -1;
+
+		auto new_end = std::remove( m_busy.begin( ), m_busy.end( ), id );
+		if ( new_end != m_busy.end( ) )
+		{
+			m_busy.erase( new_end, m_busy.end( ) );
+			m_idle.push_back( id );
+		}
+		m_voice_key[id] = -1;
+		return id;
+	}
+
+	int get_voice( int key ) const
+	{
+		return m_key_voice[key];
+	}
+
+private:
+	std::deque<int> m_idle;
+	std::deque<int> m_busy;
+	std::vector<int> m_voice_key;
+	int m_key_voice[128];
+};
+
+enum event_type
+{
+	EVENT_NOTE_ON,
+	EVENT_NOTE_OFF,
+	EVENT_RESET
+};
+
+struct event
+{
+	event_type type;
+	int key;
+};
+
+/**
+	Random events - mostly notes within two octaves (so keys get retriggered and
+	voices stolen), sometimes anywhere on the keyboard, rarely a reset.
+*/
+static std::vector<event> random_events( int n, unsigned seed, bool resets )
+{
+	std::mt19937 gen( seed );
+	std::uniform_int_distribution<int> percent( 0, 99 ), narrow( 48, 71 ), wide( 0, 127 );
+	std::vector<event> events;
+	for ( int i = 0; i < n; i++ )
+	{
+		int p = percent( gen );
+		int key = p % 10 ? narrow( gen ) : wide( gen );
+		if ( resets && p == 0 && percent( gen ) < 5 ) events.push_back( {EVENT_RESET, 0} );
+		else events.push_back( {p < 55 ? EVENT_NOTE_ON : EVENT_NOTE_OFF, key} );
+	}
+	return events;
+}
+
+template <typename T>
+static int apply( T &alloc, const event &e )
+{
+	if ( e.type == EVENT_NOTE_ON ) return alloc.note_on( e.key );
+	if ( e.type == EVENT_NOTE_OFF ) return alloc.note_off( e.key );
+	alloc.reset( );
+	return -1;
+}
+
+//! Runs both allocators on random events and returns number of errors
+template <int N>
+static int check( unsigned seed )
+{
+	voice_allocator<N> alloc;
+	legacy_allocator legacy( N );
+	auto events = random_events( event_count, seed, true );
+
+	int errors = 0;
+	for ( const auto &e : events )
+	{
+		int id = apply( alloc, e );
+		errors += id != apply( legacy, e );
+		errors += !alloc.check_invariants( );
+		for ( int key = 0; key < 128; key++ )
+			errors += alloc.get_voice( key ) != legacy.get_voice( key );
+		if ( errors ) break;
+	}
+	return errors;
+}
+
+//! Returns events per second
+template <typename T>
+static double event_rate( T &alloc, const std::vector<event> &events )
+{
+	int sum = 0;
+	double t = bench_time( [&]( )
+	{
+		for ( const auto &e : events )
+			sum += apply( alloc, e );
+		bench_clobber( &sum );
+	} );
+	return events.size( ) / t;
+}
+
+template <int N>
+static int run( )
+{
+	int errors = 0;
+	for ( unsigned seed = 1; seed <= 4; seed++ )
+		errors += check<N>( seed );
+
+	voice_allocator<N> alloc;
+	legacy_allocator legacy( N );
+	auto events = random_events( event_count, 1, false );
+	double r_legacy = event_rate( legacy, events );
+	double r_alloc = event_rate( alloc, events );
+	std::printf( "%-10d %15.1f %15.1f %10.2fx %8s\n", N, r_legacy * 1e-6, r_alloc * 1e-6, r_alloc / r_legacy, errors ? "FAIL" : "ok" );
+	return errors;
+}
+
+int main( )
+{
+	std::printf( "%-10s %15s %15s %11s %8s\n", "voices", "legacy Mev/s", "alloc Mev/s", "speedup", "check" );
+	int errors = run<4>( ) + run<16>( ) + run<64>( );
+	return errors != 0;
+}
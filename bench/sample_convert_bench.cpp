@@ -0,0 +1,273 @@
+#include <bench.hpp>
+#include <sample_convert.hpp>
+#include <cstdio>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+
+/**
+	\file sample_convert_bench.cpp
+	Compares the old per-sample conversion (clamp + truncation, one halfword store at
+	a time) against sample_convert.hpp kernels and checks their output:
+	 - halfwords seen by the I2S DMA have to match reference vectors bit for bit
+	   for 16, 24 and 32-bit samples,
+	 - without dither the result has to match rounded and saturated reference exactly,
+	 - with dither the error has to stay within 1.5 LSB and the average of a constant
+	   sub-LSB input has to be preserved (which is what dither is for).
+	Exits with non-zero status on failure.
+*/
+
+static const int block_size = 256;
+static const int block_count = 64;
+
+//! Conversion used by audio.cpp before sample_convert.hpp
+static inline float old_clamp( float x, float min, float max )
+{
+	if ( x > max ) return max;
+	else if ( x < min ) return min;
+	else return x;
+}
+
+static inline uint16_t old_float_to_dma( float x )
+{
+	return static_cast<uint16_t>( static_cast<int16_t>( 32767 * old_clamp( x, -1.f, 1.f ) ) );
+}
+
+static void old_mono( const float *buf, uint16_t *dest, int frames )
+{
+	for ( int i = 0; i < frames; i++ )
+	{
+		uint16_t sample = old_float_to_dma( buf[i] );
+		dest[2 * i] = sample;
+		dest[2 * i + 1] = sample;
+	}
+}
+
+static void old_stereo( const float *buf, uint16_t *dest, int frames )
+{
+	for ( int i = 0; i < 2 * frames; i++ )
+		dest[i] = old_float_to_dma( buf[i] );
+}
+
+//! Returns the best number of ticks per frame of f( ) converting all blocks
+template <typename F>
+static double ticks_per_frame( F f )
+{
+	double best = 1e30;
+	bench_time( [&]( )
+	{
+		uint64_t t0 = bench_ticks( );
+		f( );
+		double t = double( bench_ticks( ) - t0 ) / ( block_size * block_count );
+		if ( t < best ) best = t;
+	} );
+	return best;
+}
+
+//! Reference conversion - round to nearest and saturate
+static int16_t reference( float x )
+{
+	return std::lrint( std::fmin( std::fmax( double( x ) * 32768.0, -32768.0 ), 32767.0 ) );
+}
+
+static int16_t frame_left( uint32_t frame ) { return int16_t( frame & 0xffff ); }
+static int16_t frame_right( uint32_t frame ) { return int16_t( frame >> 16 ); }
+
+//! Sample and halfwords it has to be sent as (only the first one is used for 16-bit samples)
+struct pack_vector
+{
+	float x;
+	int bits;
+	uint16_t hw[2];
+};
+
+static const pack_vector pack_vectors[] =
+{
+	{ 0.5f,                  16, {0x4000} },
+	{ -1.f,                  16, {0x8000} },
+	{ 1.f,                   16, {0x7fff} }, // Saturated
+	{ 1.f / 65536,           16, {0x0000} }, // 0.5 LSB - ties to even
+	{ 3.f / 65536,           16, {0x0002} },
+	{ -3.f / 65536,          16, {0xfffe} },
+	{ 0.5f,                  24, {0x4000, 0x0000} },
+	{ -1.f,                  24, {0x8000, 0x0000} },
+	{ 1.f,                   24, {0x7fff, 0xff00} }, // Saturated
+	{ -0x1p-23f,             24, {0xffff, 0xff00} },
+	{ 0x123456p-23f,         24, {0x1234, 0x5600} },
+	{ 0x123456.8p-23f,       24, {0x1234, 0x5600} }, // Ties to even
+	{ 0.5f,                  32, {0x4000, 0x0000} },
+	{ -1.f,                  32, {0x8000, 0x0000} },
+	{ 1.f,                   32, {0x7fff, 0xffff} }, // Saturated
+	{ -0x1p-31f,             32, {0xffff, 0xffff} },
+	{ 0x12345680p-31f,       32, {0x1234, 0x5680} },
+};
+
+/**
+	Converts each reference vector as the left and as the right channel of a stereo
+	frame (the other channel is silent) and as a mono sample. Returns number of mismatches.
+*/
+static int check_packing( )
+{
+	int errors = 0;
+	for ( const auto &v : pack_vectors )
+	{
+		const float stereo[4] = {v.x, 0.f, 0.f, v.x};
+		uint32_t out[4];
+		uint16_t hw[8];
+		bool ok = true;
+
+		if ( v.bits == 16 )
+		{
+			const uint16_t expected_stereo[] = {v.hw[0], 0, 0, v.hw[0]};
+			const uint16_t expected_mono[] = {v.hw[0], v.hw[0]};
+			sample_convert_stereo( stereo, out, 2 );
+			std::memcpy( hw, out, sizeof expected_stereo );
+			ok = ok && std::memcmp( hw, expected_stereo, sizeof expected_stereo ) == 0;
+			sample_convert_mono( &v.x, out, 1 );
+			std::memcpy( hw, out, sizeof expected_mono );
+			ok = ok && std::memcmp( hw, expected_mono, sizeof expected_mono ) == 0;
+		}
+		else
+		{
+			const uint16_t expected_stereo[] = {v.hw[0], v.hw[1], 0, 0, 0, 0, v.hw[0], v.hw[1]};
+			const uint16_t expected_mono[] = {v.hw[0], v.hw[1], v.hw[0], v.hw[1]};
+			sample_convert_stereo_wide( stereo, out, 2, v.bits );
+			std::memcpy( hw, out, sizeof expected_stereo );
+			ok = ok && std::memcmp( hw, expected_stereo, sizeof expected_stereo ) == 0;
+			sample_convert_mono_wide( &v.x, out, 1, v.bits );
+			std::memcpy( hw, out, sizeof expected_mono );
+			ok = ok && std::memcmp( hw, expected_mono, sizeof expected_mono ) == 0;
+		}
+
+		if ( !ok )
+		{
+			std::printf( "packing mismatch: %a as %d-bit sample\n", v.x, v.bits );
+			errors++;
+		}
+	}
+
+	std::printf( "packing reference vectors: %d of %d passed\n", int( std::size( pack_vectors ) ) - errors, int( std::size( pack_vectors ) ) );
+	return errors;
+}
+
+int main( )
+{
+	const int n = block_size * block_count;
+	int errors = 0;
+
+	// Includes values beyond full scale to exercise saturation
+	auto mono = bench_uniform( n, -1.5f, 1.5f );
+	auto stereo = bench_uniform( 2 * n, -1.5f, 1.5f, 2 );
+	std::vector<uint16_t> old_out( 2 * n );
+	std::vector<uint32_t> out( n );
+	sample_dither dither;
+
+	std::printf( "%-16s %12s %12s %12s %10s\n", "conversion", "old t/frame", "new t/frame", "dither t/fr", "speedup" );
+
+	// Like in the firmware, each block is converted while it's in cache - streaming the
+	// whole test vectors would only measure memory bandwidth
+	double to = ticks_per_frame( [&]( )
+	{
+		for ( int i = 0; i < block_count; i++ )
+		{
+			old_mono( mono.data( ), old_out.data( ), block_size );
+			bench_clobber( old_out.data( ) );
+		}
+	} );
+	double tn = ticks_per_frame( [&]( )
+	{
+		for ( int i = 0; i < block_count; i++ )
+		{
+			sample_convert_mono( mono.data( ), out.data( ), block_size );
+			bench_clobber( out.data( ) );
+		}
+	} );
+	double td = ticks_per_frame( [&]( )
+	{
+		for ( int i = 0; i < block_count; i++ )
+		{
+			sample_convert_mono( mono.data( ), out.data( ), block_size, &dither );
+			bench_clobber( out.data( ) );
+		}
+	} );
+	std::printf( "%-16s %12.2f %12.2f %12.2f %9.2fx\n", "mono", to, tn, td, to / tn );
+	errors += tn >= to;
+
+	to = ticks_per_frame( [&]( )
+	{
+		for ( int i = 0; i < block_count; i++ )
+		{
+			old_stereo( stereo.data( ), old_out.data( ), block_size );
+			bench_clobber( old_out.data( ) );
+		}
+	} );
+	tn = ticks_per_frame( [&]( )
+	{
+		for ( int i = 0; i < block_count; i++ )
+		{
+			sample_convert_stereo( stereo.data( ), out.data( ), block_size );
+			bench_clobber( out.data( ) );
+		}
+	} );
+	td = ticks_per_frame( [&]( )
+	{
+		for ( int i = 0; i < block_count; i++ )
+		{
+			sample_convert_stereo( stereo.data( ), out.data( ), block_size, &dither );
+			bench_clobber( out.data( ) );
+		}
+	} );
+	std::printf( "%-16s %12.2f %12.2f %12.2f %9.2fx\n", "stereo", to, tn, td, to / tn );
+	errors += tn >= to;
+
+	errors += check_packing( ) != 0;
+
+	// Exact results without dither (odd length covers the scalar tail as well)
+	int mismatches = 0;
+	sample_convert_mono( mono.data( ), out.data( ), n - 3 );
+	for ( int i = 0; i < n - 3; i++ )
+		mismatches += frame_left( out[i] ) != reference( mono[i] ) || frame_right( out[i] ) != reference( mono[i] );
+	sample_convert_stereo( stereo.data( ), out.data( ), n - 3 );
+	for ( int i = 0; i < n - 3; i++ )
+		mismatches += frame_left( out[i] ) != reference( stereo[2 * i] ) || frame_right( out[i] ) != reference( stereo[2 * i + 1] );
+	std::printf( "mismatches without dither: %d\n", mismatches );
+	errors += mismatches != 0;
+
+	// Dither error bounds (in-range input only, saturation would add error)
+	auto small = bench_uniform( 2 * n, -0.9f, 0.9f, 3 );
+	double max_err = 0, sum_err = 0, sum_err2 = 0;
+	sample_convert_stereo( small.data( ), out.data( ), n, &dither );
+	for ( int i = 0; i < n; i++ )
+		for ( int c = 0; c < 2; c++ )
+		{
+			double e = ( c ? frame_right( out[i] ) : frame_left( out[i] ) ) - double( small[2 * i + c] ) * 32768.0;
+			max_err = std::fmax( max_err, std::fabs( e ) );
+			sum_err += e;
+			sum_err2 += e * e;
+		}
+	double mean = sum_err / ( 2 * n ), rms = std::sqrt( sum_err2 / ( 2 * n ) );
+	std::printf( "dither error: max %.3f LSB, mean %.4f LSB, rms %.3f LSB (expected 0.5)\n", max_err, mean, rms );
+	errors += max_err >= 1.5 || std::fabs( mean ) > 0.02 || std::fabs( rms - 0.5 ) > 0.05;
+
+	// Neighbouring dither values must not be correlated (the noise should be white)
+	double c0 = 0, c1 = 0;
+	for ( uint32_t i = 0; i < uint32_t( n ); i++ )
+	{
+		double a = sample_dither_tpdf( i ), b = sample_dither_tpdf( i + 1 );
+		c0 += a * a;
+		c1 += a * b;
+	}
+	std::printf( "dither lag-1 autocorrelation: %.4f\n", c1 / c0 );
+	errors += std::fabs( c1 / c0 ) > 0.03;
+
+	// A constant 0.3 LSB signal is lost without dither, but survives on average with it
+	std::vector<float> dc( n, 0.3f / 32768.f );
+	sample_convert_mono( dc.data( ), out.data( ), n, &dither );
+	double avg = 0;
+	for ( int i = 0; i < n; i++ ) avg += frame_left( out[i] );
+	avg /= n;
+	std::printf( "0.3 LSB DC with dither: average %.3f LSB\n", avg );
+	errors += std::fabs( avg - 0.3 ) > 0.02;
+
+	return errors != 0;
+}
@@ -0,0 +1,77 @@
+#include <bench.hpp>
+#include <spsc_ring.hpp>
+#include <midi.hpp>
+#include <thread>
+#include <cstdio>
+
+/**
+	\file spsc_ring_bench.cpp
+	Stress test for spsc_ring - a producer thread plays the role of the UART
+	interrupt and pushes a known sequence, while the consumer checks that every
+	element that made it through arrives intact and in order. Exits with non-zero
+	status on failure.
+*/
+
+static spsc_ring<midi_rx_byte, MIDI_BUFFER_SIZE> ring;
+
+/**
+	Pushes count elements from a separate thread. If lossless is set, the producer
+	waits for free space, so nothing may be lost. Otherwise it pushes as fast as it
+	can and the number of lost elements has to match the overflow counter.
+	Returns number of errors.
+*/
+static int stress( uint32_t count, bool lossless )
+{
+	uint32_t accepted = 0;
+	uint32_t overflow_before = ring.get_overflow_count( );
+	std::atomic<bool> done{false};
+
+	auto t0 = std::chrono::steady_clock::now( );
+
+	std::thread producer( [&]( )
+	{
+		for ( uint32_t i = 0; i < count; i++ )
+		{
+			if ( lossless )
+				while ( ring.free( ) == 0 ) std::this_thread::yield( );
+			accepted += ring.push( {uint8_t( i ), i} );
+		}
+		done = true;
+	} );
+
+	// Timestamps are consecutive sequence numbers, so lost elements show up as gaps
+	uint32_t received = 0, expected = 0, errors = 0;
+	midi_rx_byte rx;
+	while ( true )
+	{
+		if ( !ring.pop( rx ) )
+		{
+			if ( done && ring.empty( ) ) break;
+			std::this_thread::yield( );
+			continue;
+		}
+
+		if ( rx.timestamp < expected || rx.byte != uint8_t( rx.timestamp ) ) errors++;
+		if ( lossless && rx.timestamp != expected ) errors++;
+		expected = rx.timestamp + 1;
+		received++;
+	}
+
+	producer.join( );
+	double t = std::chrono::duration<double>( std::chrono::steady_clock::now( ) - t0 ).count( );
+
+	uint32_t overflows = ring.get_overflow_count( ) - overflow_before;
+	if ( received != accepted || count - received != overflows ) errors++;
+
+	std::printf( "%-9s %u pushed, %u received, %u overflows, %u errors, %.1f M items/s\n",
+		lossless ? "lossless" : "lossy", count, received, overflows, errors, count / t * 1e-6 );
+	return errors;
+}
+
+int main( )
+{
+	int errors = 0;
+	errors += stress( 5'000'000, true );
+	errors += stress( 5'000'000, false );
+	return errors != 0;
+}
@@ -0,0 +1,128 @@
+#include <bench.hpp>
+#include <bench_voice.hpp>
+#include <voice_bank.hpp>
+#include <voice_allocator.hpp>
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include <random>
+
+/**
+	\file voice_bank_bench.cpp
+	Measures cost of a voice_bank block versus the number of active voices and
+	checks that letting silent voices sleep doesn't change the output.
+
+	The voice (bench_voice.hpp) restarts its oscillator and filter on every note, so
+	a voice which slept while silent (and was cleared on waking up) has to produce
+	the same samples as one which was computed all the time. Exits with non-zero
+	status on failure.
+*/
+
+static const int sample_rate = 48000;
+static const int block_size = 64;
+static const int max_voices = 16;
+static const int sleep_hold = sample_rate / 50;
+
+/**
+	Plays random notes through voices driven by voice_allocator (like synth.cpp does)
+	and returns the output. If skip is false, all voices are computed all the time.
+	Number of computed voice blocks is added to computed.
+*/
+static std::vector<float> render( bool skip, int blocks, unsigned seed, int &computed )
+{
+	faust_dsp dsp( new bench_voice, sample_rate );
+	voice_bank bank( dsp, max_voices, shared_controls, CONTROL_COUNT, block_size );
+	voice_allocator<max_voices> alloc;
+	bank.set_sleep( alloc.silence_level, sleep_hold );
+	std::vector<float> out( blocks * block_size );
+	bool active[max_voices];
+	float levels[max_voices];
+
+	std::mt19937 gen( seed );
+	std::uniform_int_distribution<int> key( 36, 84 ), percent( 0, 99 );
+	for ( int b = 0; b < blocks; b++ )
+	{
+		// Notes start and end at random, releases of playing voices
+		if ( percent( gen ) < 20 )
+		{
+			int k = key( gen ), id;
+			if ( percent( gen ) < 25 && ( id = alloc.note_on( k ) ) >= 0 )
+			{
+				*bank.get_zone( id, NOTE ) = k;
+				*bank.get_zone( id, GATE ) = 1;
+			}
+			else if ( ( k = alloc.get_key( percent( gen ) % max_voices ) ) >= 0 && ( id = alloc.note_off( k ) ) >= 0 )
+				*bank.get_zone( id, GATE ) = 0;
+		}
+		*bank.get_zone( 0, CUTOFF ) = 0.5f + 0.5f * std::sin( b * 0.01f );
+
+		for ( int v = 0; v < max_voices; v++ )
+			active[v] = !skip || alloc.is_active( v );
+		computed += bank.compute( block_size, nullptr, &out[b * block_size], active );
+
+		for ( int v = 0; v < max_voices; v++ )
+			levels[v] = bank.get_peak( v );
+		alloc.set_levels( levels );
+	}
+	return out;
+}
+
+int main( )
+{
+	int errors = 0;
+
+	// Sleeping silent voices give the same output
+	const int blocks = 4000;
+	float max_error = 0, peak = 0;
+	int computed_all = 0, computed_skip = 0;
+	for ( unsigned seed = 1; seed <= 4; seed++ )
+	{
+		auto a = render( false, blocks, seed, computed_all ), b = render( true, blocks, seed, computed_skip );
+		for ( int i = 0; i < blocks * block_size; i++ )
+		{
+			max_error = std::fmax( max_error, std::fabs( a[i] - b[i] ) );
+			peak = std::fmax( peak, std::fabs( a[i] ) );
+		}
+	}
+	std::printf( "max difference with sleeping: %g (peak %g), %.1f%% of voice blocks computed\n",
+		max_error, peak, 100.0 * computed_skip / computed_all );
+	errors += max_error > 1e-5f * peak || computed_skip >= computed_all;
+
+	// Cost versus number of active voices
+	faust_dsp dsp( new bench_voice, sample_rate );
+	voice_bank bank( dsp, max_voices, shared_controls, CONTROL_COUNT, block_size );
+	static float out[block_size];
+	bool active[max_voices];
+	for ( int v = 0; v < max_voices; v++ )
+	{
+		*bank.get_zone( v, NOTE ) = 48 + v;
+		*bank.get_zone( v, GATE ) = 1;
+	}
+
+	std::printf( "\n%d voices, %d frame blocks\n", max_voices, block_size );
+	std::printf( "%-8s %12s %12s\n", "active", "t/block", "t/voice" );
+	double t_all = 0;
+	for ( int n : {0, 1, 2, 4, 8, 12, 16} )
+	{
+		for ( int v = 0; v < max_voices; v++ )
+			active[v] = v < n;
+
+		const int rounds = 200;
+		double best = 1e30;
+		bench_time( [&]( )
+		{
+			uint64_t t0 = bench_ticks( );
+			for ( int r = 0; r < rounds; r++ )
+			{
+				bank.compute( block_size, nullptr, out, active );
+				bench_clobber( out );
+			}
+			best = std::fmin( best, double( bench_ticks( ) - t0 ) / rounds );
+		} );
+		if ( n == max_voices ) t_all = best;
+		std::printf( "%-8d %12.1f %12.1f\n", n, best, n ? best / n : 0.0 );
+	}
+	std::printf( "all voices computed every block (as with unrolled polyphony): %.1f t/block\n", t_all );
+
+	return errors != 0;
+}
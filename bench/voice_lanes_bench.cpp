@@ -0,0 +1,234 @@
+#include <bench.hpp>
+#include <bench_voice.hpp>
+#include <voice_bank.hpp>
+#include <cstdio>
+#include <cmath>
+#include <vector>
+
+/**
+	\file voice_lanes_bench.cpp
+	Compares rendering voices one instance at a time (voice_bank running scalar code
+	like Faust generates) with rendering them struct-of-arrays - the same voice as
+	bench_voice, but with its state stored in vectors of W voices and every operation
+	applied to W voices at once (GCC vector extensions - SSE/AVX/NEON where the host
+	has them).
+
+	This is a measurement of what lane-parallel voices would be worth, not a render
+	mode - Faust only generates scalar code for one instance and the Cortex-M4 FPU
+	has no SIMD instructions, so the firmware keeps the scalar path. Reports voices
+	rendered per second (as a number of voices running in real time at 48 kHz) and
+	checks that both paths give the same output. Exits with non-zero status on failure.
+*/
+
+static const int sample_rate = 48000;
+static const int block_size = 64;
+
+//! W floats processed by one instruction (vector_size has to be given literally)
+template <int W> struct lane_type;
+template <> struct lane_type<4> {typedef float type __attribute__(( vector_size( 16 ) ));};
+template <> struct lane_type<8> {typedef float type __attribute__(( vector_size( 32 ) ));};
+
+/**
+	\brief bench_voice for W voices at once, stored struct-of-arrays
+*/
+template <int W>
+class voice_lanes
+{
+public:
+	typedef typename lane_type<W>::type lane;
+
+	explicit voice_lanes( int voices ) :
+		m_groups( ( voices + W - 1 ) / W ),
+		m_mix( block_size )
+	{
+		for ( auto &g : m_groups )
+			g = group( );
+	}
+
+	void set_voice( int voice, float note, float gate )
+	{
+		group &g = m_groups[voice / W];
+		g.note[voice % W] = note;
+		g.gate[voice % W] = gate;
+	}
+
+	//! Renders count (up to block_size) samples of all voices mixed together
+	void compute( int count, float cutoff, float *output )
+	{
+		const lane zero = {}, one = zero + 1.f;
+		float fc = 0.05f + 0.5f * cutoff;
+		float step = 1.f / ( 0.01f * sample_rate );
+
+		for ( int i = 0; i < count; i++ )
+			m_mix[i] = zero;
+
+		for ( group &g : m_groups )
+		{
+			lane f;
+			for ( int l = 0; l < W; l++ )
+				f[l] = 440.f * std::exp( ( g.note[l] - 69.f ) * 0.0577622650f ) / sample_rate;
+			lane delta = g.gate > zero ? zero + step : zero - step;
+			lane trigger = g.gate > g.last_gate ? one : zero;
+			g.phase = trigger != zero ? zero : g.phase;
+			g.lp = trigger != zero ? zero : g.lp;
+			g.last_gate = g.gate;
+
+			lane phase = g.phase, lp = g.lp, env = g.env;
+			for ( int i = 0; i < count; i++ )
+			{
+				phase += f;
+				phase = phase >= one ? phase - one : phase;
+				lp += fc * ( 2.f * phase - 1.f - lp );
+				env += delta;
+				env = env < zero ? zero : env;
+				env = env > one ? one : env;
+				m_mix[i] += 0.25f * lp * env;
+			}
+			g.phase = phase;
+			g.lp = lp;
+			g.env = env;
+		}
+
+		for ( int i = 0; i < count; i++ )
+		{
+			float sum = 0;
+			for ( int l = 0; l < W; l++ )
+				sum += m_mix[i][l];
+			output[i] = sum;
+		}
+	}
+
+private:
+	//! State of W voices
+	struct group
+	{
+		lane note, gate;
+		lane phase, lp, env, last_gate;
+	};
+
+	std::vector<group> m_groups;
+	std::vector<lane> m_mix;  //!< Output of each lane, summed across groups
+};
+
+//! Note and gate of a voice at a block - chords starting and ending at different times
+static void voice_state( int voice, int block, float &note, float &gate )
+{
+	note = 40 + ( voice * 7 ) % 36;
+	gate = ( ( block + voice * 13 ) % 200 ) < 120;
+}
+
+//! Scalar path - a voice_bank of bench_voice instances, all of them computed
+struct scalar_path
+{
+	explicit scalar_path( int voices ) :
+		dsp( new bench_voice, sample_rate ),
+		bank( dsp, voices, shared_controls, CONTROL_COUNT, block_size ),
+		active( new bool[voices] )
+	{
+		for ( int v = 0; v < voices; v++ )
+			active[v] = true;
+	}
+
+	void compute( int block, float cutoff, float *output )
+	{
+		for ( int v = 0; v < bank.size( ); v++ )
+			voice_state( v, block, *bank.get_zone( v, NOTE ), *bank.get_zone( v, GATE ) );
+		*bank.get_zone( 0, CUTOFF ) = cutoff;
+		bank.compute( block_size, nullptr, output, active.get( ) );
+	}
+
+	faust_dsp dsp;
+	voice_bank bank;
+	std::unique_ptr<bool[]> active;
+};
+
+//! Lane-parallel path
+template <int W>
+struct lanes_path
+{
+	explicit lanes_path( int voices ) :
+		lanes( voices ),
+		voices( voices )
+	{
+	}
+
+	void compute( int block, float cutoff, float *output )
+	{
+		for ( int v = 0; v < voices; v++ )
+		{
+			float note, gate;
+			voice_state( v, block, note, gate );
+			lanes.set_voice( v, note, gate );
+		}
+		lanes.compute( block_size, cutoff, output );
+	}
+
+	voice_lanes<W> lanes;
+	int voices;
+};
+
+//! Returns max difference between outputs of two paths rendering the same notes
+template <typename A, typename B>
+static float max_difference( A &a, B &b, float &peak )
+{
+	static float out_a[block_size], out_b[block_size];
+	float diff = 0;
+	for ( int block = 0; block < 2000; block++ )
+	{
+		float cutoff = 0.5f + 0.5f * std::sin( block * 0.01f );
+		a.compute( block, cutoff, out_a );
+		b.compute( block, cutoff, out_b );
+		for ( int i = 0; i < block_size; i++ )
+		{
+			diff = std::fmax( diff, std::fabs( out_a[i] - out_b[i] ) );
+			peak = std::fmax( peak, std::fabs( out_a[i] ) );
+		}
+	}
+	return diff;
+}
+
+//! Returns number of voices rendered in real time
+template <typename T>
+static double realtime_voices( T &path, int voices )
+{
+	static float out[block_size];
+	const int blocks = 200;
+	double t = bench_time( [&]( )
+	{
+		for ( int block = 0; block < blocks; block++ )
+		{
+			path.compute( block, 0.5f, out );
+			bench_clobber( out );
+		}
+	} );
+	return double( voices ) * blocks * block_size / t / sample_rate;
+}
+
+static int run( int voices )
+{
+	// Summing order differs between the paths, so they match only within rounding
+	scalar_path scalar_a( voices ), scalar_b( voices );
+	lanes_path<4> lanes4( voices );
+	lanes_path<8> lanes8( voices );
+	float peak = 0;
+	float diff = std::fmax( max_difference( scalar_a, lanes4, peak ), max_difference( scalar_b, lanes8, peak ) );
+	int errors = diff > 1e-4f * peak;
+
+	scalar_path s( voices );
+	lanes_path<4> l4( voices );
+	lanes_path<8> l8( voices );
+	double r_scalar = realtime_voices( s, voices );
+	double r_lanes4 = realtime_voices( l4, voices );
+	double r_lanes8 = realtime_voices( l8, voices );
+	std::printf( "%-8d %10.0f %10.0f %7.2fx %10.0f %7.2fx %10.2g %6s\n", voices,
+		r_scalar, r_lanes4, r_lanes4 / r_scalar, r_lanes8, r_lanes8 / r_scalar, diff, errors ? "FAIL" : "ok" );
+	return errors;
+}
+
+int main( )
+{
+	std::printf( "voices rendered in real time at %d Hz, %d frame blocks\n", sample_rate, block_size );
+	std::printf( "%-8s %10s %10s %8s %10s %8s %10s %6s\n", "voices", "scalar", "4 lanes", "speedup", "8 lanes", "speedup", "max diff", "check" );
+	int errors = run( 4 ) + run( 8 ) + run( 16 );
+	return errors != 0;
+}
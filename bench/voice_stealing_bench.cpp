@@ -0,0 +1,237 @@
+#include <bench.hpp>
+#include <voice_allocator.hpp>
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+/**
+	\file voice_stealing_bench.cpp
+	Counts discontinuities caused by voice assignment - a voice which gets a new
+	note while it's still audible makes a step as large as its level, which is
+	counted as a click above click_level.
+
+	Chord-heavy MIDI streams are played through simulated ADSR voices, with levels
+	passed to the allocator at every block (like the DSP's level_N bargraphs) and
+	without them (the previous policy - released voices are idle right away and the
+	oldest one is taken). The dense stream keeps all voices taken, so released voices
+	are rarely quieter than held ones, the sparse one leaves time for the releases to
+	fade and in the plucked one, held notes decay to silence. Exits with non-zero status
+	if levels make more clicks or a larger worst step with any number of voices, if they
+	don't save clicks and reduce the sum of steps over all voice counts of a stream, if
+	a held voice is stolen while there's a released one, if a released voice above
+	click_level is taken while there's one below it, if a louder one below click_level
+	is taken before a quieter one or if the allocator's invariants break.
+*/
+
+static const float sample_rate = 48000;
+static const int block_size = 32;
+static const float click_level = voice_allocator<1>::click_level;
+static const float attack_time = 0.005f;
+static const float release_time = 0.15f;
+
+struct event
+{
+	int block;
+	bool on;
+	int key;
+	float gain;
+};
+
+//! ADSR envelope run once per block (levels change slowly compared to block length)
+struct envelope
+{
+	void process( int frames )
+	{
+		float t = frames / sample_rate;
+		if ( !gate ) env *= std::exp( -t / release_time );
+		else if ( attack ) env = std::min( env + t / attack_time, 1.f ), attack = env < 1;
+		else env = sustain + ( env - sustain ) * std::exp( -t / decay );
+		level = gain * env;
+	}
+
+	bool gate = false;
+	bool attack = false;
+	float decay = 0;
+	float sustain = 0;
+	float gain = 0;
+	float env = 0;
+	float level = 0;
+};
+
+//! Timing of chords played by chord_events( ) (in ms) and envelope of the voices
+struct scenario
+{
+	const char *name;
+	int min_gap, max_gap;
+	int min_length, max_length;
+	int melody;  //!< Percentage of chords with a melody note
+	float decay;
+	float sustain;
+};
+
+static const scenario scenarios[] =
+{
+	{"dense", 200, 600, 50, 1200, 40, 0.3f, 0.3f},
+	{"sparse", 300, 600, 100, 900, 0, 0.3f, 0.3f},
+	{"plucked", 200, 600, 500, 3000, 40, 0.1f, 0.f},
+};
+
+/**
+	Chords of three notes with random velocities, each note released at a different
+	time, sometimes with a melody note on top - 60 s of events
+*/
+static std::vector<event> chord_events( const scenario &s, unsigned seed )
+{
+	std::mt19937 gen( seed );
+	std::uniform_int_distribution<int> root( 48, 60 ), length( s.min_length, s.max_length ), gap( s.min_gap, s.max_gap ), percent( 0, 99 );
+	std::uniform_real_distribution<float> velocity( 0.2f, 1.f );
+	auto ms_to_block = []( int ms ){return int( ms * 1e-3f * sample_rate / block_size );};
+
+	std::vector<event> events;
+	for ( int t = 0; t < 60000; t += gap( gen ) )
+	{
+		int r = root( gen );
+		for ( int k : {0, 4, 7} )
+		{
+			events.push_back( {ms_to_block( t ), true, r + k, velocity( gen )} );
+			events.push_back( {ms_to_block( t + length( gen ) ), false, r + k, 0} );
+		}
+		if ( percent( gen ) < s.melody )
+		{
+			int d = gap( gen ) / 2, key = r + 12 + percent( gen ) % 12;
+			events.push_back( {ms_to_block( t + d ), true, key, velocity( gen )} );
+			events.push_back( {ms_to_block( t + d + length( gen ) ), false, key, 0} );
+		}
+	}
+
+	// Note offs first within a block, so a chord can reuse its own voices
+	std::stable_sort( events.begin( ), events.end( ), []( const event &a, const event &b )
+	{
+		return a.block < b.block || ( a.block == b.block && !a.on && b.on );
+	} );
+	return events;
+}
+
+struct result
+{
+	int notes = 0;
+	int clicks = 0;
+	float worst = 0;
+	double sum = 0;  //!< Sum of all steps
+	int errors = 0;
+};
+
+template <int N>
+static result play( const std::vector<event> &events, const scenario &s, bool use_levels )
+{
+	voice_allocator<N> alloc;
+	envelope env[N];
+	float levels[N] = {0};
+	result res;
+
+	size_t next = 0;
+	for ( int block = 0; next < events.size( ); block++ )
+	{
+		for ( ; next < events.size( ) && events[next].block == block; next++ )
+		{
+			const event &e = events[next];
+			if ( !e.on )
+			{
+				int id = alloc.note_off( e.key );
+				if ( id >= 0 ) env[id].gate = false;
+				continue;
+			}
+
+			// Retriggered key releases its voice first (like polyphony_controller does)
+			if ( alloc.get_voice( e.key ) >= 0 )
+				env[alloc.get_voice( e.key )].gate = false;
+
+			int id = alloc.note_on( e.key );
+
+			// Held voices are only stolen if there are no released ones and then the quietest
+			// released voice (as last reported) is taken if it's below click_level - all silent
+			// ones are equal and if none is below click_level, the note clicks anyway
+			bool quiet = levels[id] < click_level;
+			for ( int i = 0; i < N; i++ )
+			{
+				if ( i == id || env[i].gate ) continue;
+				res.errors += env[id].gate;
+				res.errors += use_levels && levels[id] >= alloc.silence_level && levels[i] < ( quiet ? levels[id] : click_level );
+			}
+
+			res.notes++;
+			if ( env[id].level > click_level ) res.clicks++;
+			res.worst = std::max( res.worst, env[id].level );
+			res.sum += env[id].level;
+			env[id].gate = env[id].attack = true;
+			env[id].gain = e.gain;
+			env[id].decay = s.decay;
+			env[id].sustain = s.sustain;
+			res.errors += !alloc.check_invariants( );
+		}
+
+		for ( int i = 0; i < N; i++ )
+		{
+			env[i].process( block_size );
+			levels[i] = env[i].level;
+		}
+		if ( use_levels )
+			alloc.set_levels( levels );
+	}
+	return res;
+}
+
+//! Adds results of r to total
+static void add( result &total, const result &r )
+{
+	total.notes += r.notes;
+	total.clicks += r.clicks;
+	total.sum += r.sum;
+	total.worst = std::max( total.worst, r.worst );
+	total.errors += r.errors;
+}
+
+/**
+	Plays the stream with N voices, adds the results to scenario totals and returns
+	number of errors - levels may not make more clicks or a larger worst step
+*/
+template <int N>
+static int run( const scenario &s, result &old_scenario, result &new_scenario )
+{
+	result old_total, new_total;
+	for ( unsigned seed = 1; seed <= 8; seed++ )
+	{
+		auto events = chord_events( s, seed );
+		add( old_total, play<N>( events, s, false ) );
+		add( new_total, play<N>( events, s, true ) );
+	}
+	add( old_scenario, old_total );
+	add( new_scenario, new_total );
+
+	int errors = old_total.errors + new_total.errors;
+	errors += new_total.clicks > old_total.clicks || new_total.worst > old_total.worst;
+	std::printf( "%-8s %8d %8d %8d %8.1f %8.3f %8d %8.1f %8.3f %8s\n", s.name, N, old_total.notes,
+		old_total.clicks, old_total.sum, old_total.worst,
+		new_total.clicks, new_total.sum, new_total.worst, errors ? "FAIL" : "ok" );
+	return errors;
+}
+
+int main( )
+{
+	std::printf( "%-8s %8s %8s %26s %26s\n", "", "", "", "oldest", "quiet first" );
+	std::printf( "%-8s %8s %8s %8s %8s %8s %8s %8s %8s %8s\n", "stream", "voices", "notes", "clicks", "steps", "worst", "clicks", "steps", "worst", "check" );
+	int errors = 0;
+	for ( const scenario &s : scenarios )
+	{
+		// Over all voice counts, levels have to save clicks and make the steps smaller
+		result old_total, new_total;
+		errors += run<4>( s, old_total, new_total ) + run<6>( s, old_total, new_total ) + run<8>( s, old_total, new_total );
+		int e = new_total.clicks >= old_total.clicks || new_total.sum > old_total.sum;
+		std::printf( "%-8s %8s %8d %8d %8.1f %8s %8d %8.1f %8s %8s\n", s.name, "all", old_total.notes, old_total.clicks, old_total.sum, "",
+			new_total.clicks, new_total.sum, "", e ? "FAIL" : "ok" );
+		errors += e;
+	}
+	return errors != 0;
+}
@@ -0,0 +1,117 @@
+#include <com.hpp>
+#include <spsc_ring.hpp>
+
+/**
+	\file com.cpp
+	Debug console. Messages are put in a ring buffer, from which they are sent out
+	by UART DMA. In non-blocking mode, messages that don't fit in the buffer are dropped,
+	so printing never stalls the audio loop.
+
+	The main loop is the only producer - com*() functions must not be called from interrupts.
+	The consumer side is the UART Tx complete interrupt.
+*/
+
+static spsc_ring<char, COM_BUFFER_SIZE> com_buffer;
+
+//! Set when DMA transfer is in progress
+static volatile bool com_tx_busy = false;
+
+//! Length of the current DMA transfer
+static volatile size_t com_tx_length = 0;
+
+//! Whether to wait for free space in the buffer or drop messages
+static volatile bool com_blocking = true;
+
+volatile int com_drop_counter = 0;
+
+/**
+	Starts DMA transfer of the data waiting in the buffer (unless one is already in progress).
+	Must not be interrupted by the UART Tx complete interrupt.
+*/
+static void com_kick( )
+{
+	if ( com_tx_busy ) return;
+
+	size_t len;
+	const char *data = com_buffer.peek_contiguous( len );
+	if ( !len ) return;
+	if ( len > 0xffff ) len = 0xffff;
+
+	com_tx_length = len;
+	com_tx_busy = true;
+	if ( HAL_UART_Transmit_DMA( &com_uart, reinterpret_cast<uint8_t*>( const_cast<char*>( data ) ), len ) != HAL_OK )
+		com_tx_busy = false;
+}
+
+/**
+	Calls com_kick( ) from the main loop
+*/
+static void com_start_tx( )
+{
+	uint32_t primask = __get_PRIMASK( );
+	__disable_irq( );
+	com_kick( );
+	__set_PRIMASK( primask );
+}
+
+/**
+	General UART Tx complete interrupt. It's here because it's only used for the debug UART
+*/
+void HAL_UART_TxCpltCallback( UART_HandleTypeDef *h )
+{
+	if ( h == &com_uart )
+	{
+		com_buffer.consume( com_tx_length );
+		com_tx_busy = false;
+		com_kick( );
+	}
+}
+
+/**
+	Enqueues data for transmission. In blocking mode waits for free space in the buffer.
+	Otherwise, if the data doesn't fit, it's dropped entirely and com_drop_counter is incremented.
+	Returns number of bytes enqueued.
+*/
+int comwrite( const char *data, size_t len )
+{
+	if ( com_blocking )
+	{
+		size_t sent = 0;
+		while ( sent < len )
+		{
+			size_t n = len - sent;
+			if ( n > com_buffer.free( ) ) n = com_buffer.free( );
+			com_buffer.push_all( data + sent, n );
+			sent += n;
+			com_start_tx( );
+		}
+		return sent;
+	}
+
+	if ( !com_buffer.push_all( data, len ) )
+	{
+		com_drop_counter++;
+		return 0;
+	}
+
+	com_start_tx( );
+	return len;
+}
+
+/**
+	Selects whether com*() functions wait for free space in the buffer (blocking)
+	or drop messages. Blocking is the default.
+*/
+void com_set_blocking( bool blocking )
+{
+	com_blocking = blocking;
+}
+
+/**
+	Waits until all data has been sent
+*/
+void com_flush( )
+{
+	while ( com_tx_busy || !com_buffer.empty( ) )
+		com_start_tx( );
+}
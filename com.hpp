@@ -7,27 +7,44 @@
 
 #include <usart.h>
 
+//! Peripheral alias
+static UART_HandleTypeDef &com_uart = huart1;
+
+//! Size of the transmit buffer - must be a power of two
+#define COM_BUFFER_SIZE 2048
+
+//! Max length of a single formatted message
+#define COM_MESSAGE_SIZE 256
+
+//! Number of messages dropped because the transmit buffer was full
+extern volatile int com_drop_counter;
+
+extern int comwrite( const char *data, size_t len );
+extern void com_set_blocking( bool blocking );
+extern void com_flush( );
+
+/**
+	Sends a string over the debug UART. See comwrite( ).
+*/
 static inline int comstr( const char *s )
 {
-	auto len = strlen( s );
-	HAL_UART_Transmit( &huart1, reinterpret_cast<uint8_t*>( const_cast<char*>( s ) ), len, 100 );
-	return len;
+	return comwrite( s, strlen( s ) );
 }
 
 /**
-	\todo Use DMA!!!!
+	Formats a message and sends it over the debug UART. See comwrite( ).
 */
 static inline int comprintf( const char *format, ... ) __attribute__((format(printf, 1, 2)));
-static inline int comprintf( const char *format, ... ) 
+static inline int comprintf( const char *format, ... )
 {
-	static char buf[256];
-	
+	char buf[COM_MESSAGE_SIZE];
+
 	va_list ap;
 	va_start( ap, format );
 	int len = vsnprintf( buf, sizeof buf, format, ap );
 	va_end( ap );
-	comstr( buf );
-	return len;
+	if ( len < 0 ) return len;
+	return comwrite( buf, len < int( sizeof buf ) ? len : sizeof buf - 1 );
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,178 @@
+#ifndef CONTROL_MAP_HPP
+#define CONTROL_MAP_HPP
+
+#include <array>
+#include <cstdint>
+#include <cmath>
+#include <stdexcept>
+#include <fast_math_block.hpp>
+#include <faust_controls.hpp>
+
+/**
+	\file control_map.hpp
+	Maps analog inputs (0 to 1) onto DSP control values.
+
+	Every control is described by an input index and an affine transform u = offset + scale * x
+	followed by a response curve:
+	 - linear - u is the value (offset = min, scale = max - min),
+	 - exponential - u is the logarithm of the value (offset = log(min), scale = log(max / min)),
+	 - stepped - u is the number of steps above min, rounded to the nearest integer.
+	Controls are kept grouped by curve, so the transform is a single pass over all of them and
+	each curve is one branch-free loop over a contiguous range.
+
+	Smoothed controls follow the mapped value with the same one-pole filter as Faust's si.smoo,
+	but it's evaluated once per apply( ) (i.e. per sub-block) instead of on every sample - the DSP
+	gets a value which is constant within the sub-block and equal to what si.smoo would reach in
+	its middle. While ramping( ), the caller should split the block into short sub-blocks, so
+	a moving control becomes a ramp of fine steps rather than one step per block.
+*/
+
+/**
+	\brief Maps analog inputs onto at most N DSP controls
+*/
+template <int N>
+class control_map
+{
+public:
+	//! Pole of the smoothing filter per sample - same as in si.smoo
+	static constexpr float smooth_pole = 0.999f;
+
+	//! Smoothed controls moving less than this fraction of their range within a block aren't ramping
+	static constexpr float ramp_threshold = 1e-3f;
+
+	/**
+		Adds a control driven by input src (index in the array passed to update( )).
+		Exponential curves require min and max to be positive, stepped ones require positive step.
+	*/
+	void add( float *dst, int src, faust_curve_type curve, float min, float max, float step, bool smooth = false )
+	{
+		if ( m_count >= N )
+			throw std::runtime_error( "too many controls in control_map" );
+
+		// Insert at the end of the curve's group
+		int pos = m_count;
+		if ( curve == CURVE_LINEAR ) pos = m_exp_begin;
+		else if ( curve == CURVE_EXP ) pos = m_step_begin;
+		for ( int i = m_count; i > pos; i-- )
+			move( i - 1, i );
+		m_count++;
+		if ( curve == CURVE_LINEAR ) m_exp_begin++;
+		if ( curve != CURVE_STEP ) m_step_begin++;
+
+		m_dst[pos] = dst;
+		m_src[pos] = src;
+		m_min[pos] = min;
+		m_step[pos] = step;
+		m_smooth[pos] = smooth;
+		m_range[pos] = std::fabs( max - min );
+		m_state[pos] = 0;
+		m_target[pos] = 0;
+		m_primed = false;
+		if ( curve == CURVE_EXP )
+		{
+			m_offset[pos] = std::log( min );
+			m_scale[pos] = std::log( max / min );
+		}
+		else if ( curve == CURVE_STEP )
+		{
+			m_offset[pos] = 0;
+			m_scale[pos] = ( max - min ) / step;
+		}
+		else
+		{
+			m_offset[pos] = min;
+			m_scale[pos] = max - min;
+		}
+	}
+
+	//! Number of mapped controls
+	int size( ) const
+	{
+		return m_count;
+	}
+
+	/**
+		Reads new targets of all controls from inputs for a block of frames samples.
+		Not smoothed controls are set to the target in apply( ), smoothed ones move
+		towards it as si.smoo would. The first update sets all of them directly.
+	*/
+	void update( const volatile float *inputs, int frames )
+	{
+		float u[N ? N : 1] = {};
+
+		for ( int i = 0; i < m_count; i++ )
+			u[i] = m_offset[i] + m_scale[i] * inputs[m_src[i]];
+
+		for ( int i = m_exp_begin; i < m_step_begin; i++ )
+			u[i] = fast_expf_bits( u[i] );
+
+		for ( int i = m_step_begin; i < m_count; i++ )
+			u[i] = m_min[i] + m_step[i] * fast_roundf_int( u[i] );
+
+		// The block starts where the previous one ended
+		float decay = fast_expf_bits( m_frames * std::log( smooth_pole ) );
+		float block_decay = fast_expf_bits( frames * std::log( smooth_pole ) );
+		m_frames = frames;
+		m_ramping = false;
+		for ( int i = 0; i < m_count; i++ )
+		{
+			m_state[i] = m_primed ? m_target[i] + decay * ( m_state[i] - m_target[i] ) : u[i];
+			m_target[i] = u[i];
+			m_ramping |= m_smooth[i] * std::fabs( m_state[i] - u[i] ) * ( 1 - block_decay ) > ramp_threshold * m_range[i];
+		}
+		m_primed = true;
+	}
+
+	/**
+		Sets controls for the sub-block [begin; end) of the block passed to the last update( )
+	*/
+	void apply( int begin, int end )
+	{
+		float decay = fast_expf_bits( 0.5f * ( begin + end ) * std::log( smooth_pole ) );
+		for ( int i = 0; i < m_count; i++ )
+			*m_dst[i] = m_target[i] + m_smooth[i] * decay * ( m_state[i] - m_target[i] );
+	}
+
+	//! Whether any smoothed control moves noticeably within the block passed to the last update( )
+	bool ramping( ) const
+	{
+		return m_ramping;
+	}
+
+private:
+	//! Moves control from index i to j
+	void move( int i, int j )
+	{
+		m_dst[j] = m_dst[i];
+		m_src[j] = m_src[i];
+		m_offset[j] = m_offset[i];
+		m_scale[j] = m_scale[i];
+		m_min[j] = m_min[i];
+		m_step[j] = m_step[i];
+		m_smooth[j] = m_smooth[i];
+		m_range[j] = m_range[i];
+		m_state[j] = m_state[i];
+		m_target[j] = m_target[i];
+	}
+
+	std::array<float*, N> m_dst;
+	std::array<uint8_t, N> m_src;
+	std::array<float, N> m_offset;
+	std::array<float, N> m_scale;
+	std::array<float, N> m_min;
+	std::array<float, N> m_step;
+	std::array<float, N> m_smooth;  //!< 1 for smoothed controls, 0 for others
+	std::array<float, N> m_range;   //!< |max - min|
+	std::array<float, N> m_state;   //!< Value of each control at the start of the block
+	std::array<float, N> m_target;  //!< Mapped input value of each control
+	int m_frames = 0;               //!< Length of the block passed to the last update( )
+	bool m_primed = false;
+	bool m_ramping = false;
+
+	//! Linear curves are at [0; m_exp_begin), exponential at [m_exp_begin; m_step_begin), stepped above
+	int m_count = 0;
+	int m_exp_begin = 0;
+	int m_step_begin = 0;
+};
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef FAST_MATH_BLOCK_HPP
+#define FAST_MATH_BLOCK_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <fast_math.hpp>
+
+/**
+	\file fast_math_block.hpp
+	Array versions of functions from fast_math.hpp. Loop bodies contain no branches
+	and no table lookups, so the compiler can vectorize them (SSE/AVX on the host).
+	Cortex-M4 FPU has no SIMD, but there the loops still avoid pipeline stalls
+	caused by branches and let the compiler schedule multiply-adds back to back.
+
+	Input and output arrays must not overlap.
+*/
+
+//! Reinterprets integer bits as a float
+static inline float fast_math_int_bits_to_float( int32_t i )
+{
+	float f;
+	std::memcpy( &f, &i, sizeof f );
+	return f;
+}
+
+//! Reinterprets float bits as an integer
+static inline int32_t fast_math_float_bits_to_int( float f )
+{
+	int32_t i;
+	std::memcpy( &i, &f, sizeof i );
+	return i;
+}
+
+/**
+	Branchless round to nearest integer (ties away from zero are not guaranteed)
+*/
+static inline int fast_roundf_int( float x )
+{
+	float t = x + 0.5f;
+	int n = t;
+	return n - ( t < n );
+}
+
+/**
+	Branchless floor( ) - unlike fast_floorf( ), correct for negative integers as well
+*/
+static inline int fast_floorf_int( float x )
+{
+	int n = x;
+	return n - ( x < n );
+}
+
+/**
+	2^x for x in [-0.5; 0.5] approximated with Taylor series (relative error < 3e-6)
+*/
+static inline float fast_exp2f_taylor( float f )
+{
+	return fmaf( fmaf( fmaf( fmaf( fmaf( 0.0013333558f, f, 0.0096181291f ), f, 0.0555041087f ), f, 0.2402265070f ), f, 0.6931471806f ), f, 1.f );
+}
+
+/**
+	Branchless exponential function. Unlike fast_expf( ), it doesn't use a lookup table -
+	e^x is computed as 2^n * 2^f, where 2^n is assembled directly in the exponent bits.
+	Arguments are clamped to the normal float range.
+*/
+static inline float fast_expf_bits( float x )
+{
+	float t = x * 1.44269504089f; // log2(e)
+	t = fminf( fmaxf( t, -126.f ), 127.f );
+	int n = fast_roundf_int( t );
+	return fast_exp2f_taylor( t - n ) * fast_math_int_bits_to_float( ( n + 127 ) << 23 );
+}
+
+/**
+	Branchless version of fast_tanf_pade( )
+*/
+static inline float fast_tanf_pade_branchless( float x )
+{
+	x = x - M_PI * fast_floorf_int( x * ( 1.f / M_PI ) ); // Modulo pi
+	return x * ( (1.f/6.f)*x*x - (5.f/2.f) ) / ( x * x - (5.f/2.f) );
+}
+
+/**
+	Branchless sine - same approximation as fast_sinf( ), but the argument is folded
+	into [0; pi/2] arithmetically.
+*/
+static inline float fast_sinf_branchless( float x )
+{
+	x -= ( 2 * M_PI ) * fast_roundf_int( x * ( 1.f / ( 2 * M_PI ) ) ); // [-pi; pi]
+	float a = fabsf( x );
+	a = fminf( a, M_PI - a ); // sin(a) = sin(pi - a)
+	return copysignf( fast_sinf_chebyshev( a ), x );
+}
+
+//! y[i] = e^x[i]
+static inline void fast_expf_block( const float *__restrict x, float *__restrict y, int n )
+{
+	for ( int i = 0; i < n; i++ )
+		y[i] = fast_expf_bits( x[i] );
+}
+
+/**
+	log2(x) - same approximation as fast_log2f( )
+*/
+static inline float fast_log2f_bits( float x )
+{
+	int32_t xi = fast_math_float_bits_to_int( x );
+	int e = ( ( xi >> 23 ) & 0xff ) - 127;
+	float m = 1.f + ( xi & 0x7fffff ) * ( 1.f / 0x7fffff );
+	return e + fast_log2f_taylor( m );
+}
+
+//! y[i] = log2(x[i])
+static inline void fast_log2f_block( const float *__restrict x, float *__restrict y, int n )
+{
+	for ( int i = 0; i < n; i++ )
+		y[i] = fast_log2f_bits( x[i] );
+}
+
+//! y[i] = ln(x[i])
+static inline void fast_logf_block( const float *__restrict x, float *__restrict y, int n )
+{
+	for ( int i = 0; i < n; i++ )
+		y[i] = 0.69314718056f * fast_log2f_bits( x[i] );
+}
+
+//! y[i] = tan(x[i])
+static inline void fast_tanf_block( const float *__restrict x, float *__restrict y, int n )
+{
+	for ( int i = 0; i < n; i++ )
+		y[i] = fast_tanf_pade_branchless( x[i] );
+}
+
+//! y[i] = sin(x[i])
+static inline void fast_sinf_block( const float *__restrict x, float *__restrict y, int n )
+{
+	for ( int i = 0; i < n; i++ )
+		y[i] = fast_sinf_branchless( x[i] );
+}
+
+#endif
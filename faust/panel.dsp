@@ -2,25 +2,26 @@ import("stdfaust.lib");
 import("j.lib");
 
 declare polyphony "4";
+declare instanced "1";
 
 // EG
 eg( gate ) = en.adsre( A, D, S, R, gate )
 with
 {
-	A = hslider( "A [analog: c5]", 0.5, 0, 1, 0.001 ) : lin2exp( 0.01, 4 ) : si.smoo;
-	D = hslider( "D [analog: c6]", 0.5, 0, 1, 0.001 ) : lin2exp( 0.01, 4 ) : si.smoo;
-	S = hslider( "S [analog: c3]", 0.5, 0, 1, 0.001 ) : si.smoo;
-	R = hslider( "R [analog: c4]", 0.5, 0, 1, 0.001 ) : lin2exp( 0.01, 4 ) : si.smoo;
+	A = hslider( "A [analog: c5] [curve: exp] [smooth: block]", 0.2, 0.01, 4, 0.001 );
+	D = hslider( "D [analog: c6] [curve: exp] [smooth: block]", 0.2, 0.01, 4, 0.001 );
+	S = hslider( "S [analog: c3] [smooth: block]", 0.5, 0, 1, 0.001 );
+	R = hslider( "R [analog: c4] [curve: exp] [smooth: block]", 0.2, 0.01, 4, 0.001 );
 };
 
 // filter EG
 feg( gate ) = en.adsre( A, D, S, R, gate )
 with
 {
-	A = hslider( "FA [analog: c9]", 0.5, 0, 1, 0.001 ) : lin2exp( 0.01, 4 ) : si.smoo;
-	D = hslider( "FD [analog: c10]", 0.5, 0, 1, 0.001 ) : lin2exp( 0.01, 4 ) : si.smoo;
-	S = hslider( "FS [analog: c7]", 0.5, 0, 1, 0.001 ) : si.smoo;
-	R = hslider( "FR [analog: c8]", 0.5, 0, 1, 0.001 ) : lin2exp( 0.01, 4 ) : si.smoo;
+	A = hslider( "FA [analog: c9] [curve: exp] [smooth: block]", 0.2, 0.01, 4, 0.001 );
+	D = hslider( "FD [analog: c10] [curve: exp] [smooth: block]", 0.2, 0.01, 4, 0.001 );
+	S = hslider( "FS [analog: c7] [smooth: block]", 0.5, 0, 1, 0.001 );
+	R = hslider( "FR [analog: c8] [curve: exp] [smooth: block]", 0.2, 0.01, 4, 0.001 );
 };
 
 
@@ -31,10 +32,11 @@ osc( note ) = ( polyblep_triangle( f ) + polyblep_saw(f1) + polyblep_saw(f2) ) /
 // osc( note ) = ( os.triangle( f ) + os.sawtooth(f1) + os.sawtooth(f2) ) / 3
 with
 {
-	oct1 = hslider( "osc1oct [analog: d10]", 0, -1.5, 1.5, 1 ) : int : _ * 12;
-	oct2 = hslider( "osc2oct  [analog: d9]", 0, -1.5, 1.5, 1 ) : int : _ * 12;
-  	note1 = note + ( hslider( "osc1tune [analog: d7]", 0, -12, 12, 0.001 ) : si.smoo ) + oct1;
-	note2 = note + ( hslider( "osc2tune [analog: d8]", 0, -12, 12, 0.001 ) : si.smoo ) + oct2;
+	// Steps of -1.5..1.5 truncated by int - the middle octave takes 2/3 of the knob's travel
+	oct1 = hslider( "osc1oct [analog: d10] [curve: step]", 0, -1.5, 1.5, 1 ) : int : _ * 12;
+	oct2 = hslider( "osc2oct  [analog: d9] [curve: step]", 0, -1.5, 1.5, 1 ) : int : _ * 12;
+  	note1 = note + hslider( "osc1tune [analog: d7] [smooth: block]", 0, -12, 12, 0.001 ) + oct1;
+	note2 = note + hslider( "osc2tune [analog: d8] [smooth: block]", 0, -12, 12, 0.001 ) + oct2;
 	tri_enabled = hslider( "trienabled [analog: d4]", 0, 0, 1.5, 0.001 ) : int;
 	f = note : mid2hz;
 	f1 = note1 : mid2hz;
@@ -45,9 +47,9 @@ with
 lpf_moog( envelope ) = ve.moog_vcf_2b( resonance, cutoff )
 with
 {
-	fc_knob = hslider( "fc [analog: d3]", 0.5, 0, 1, 0.001 ) : si.smoo;
-	envelope_int = hslider( "fc_env_int [analog: d6]", 0, -1, 1, 0.001 ) : si.smoo;
-	resonance = hslider( "reso [analog: d5]", 0.5, 0, 1, 0.001 ) : si.smoo;
+	fc_knob = hslider( "fc [analog: d3] [smooth: block]", 0.5, 0, 1, 0.001 );
+	envelope_int = hslider( "fc_env_int [analog: d6] [smooth: block]", 0, -1, 1, 0.001 );
+	resonance = hslider( "reso [analog: d5] [smooth: block]", 0.5, 0, 1, 0.001 );
   
 	fc_env = envelope_int * envelope;
 	cutoff =  ( fc_knob + fc_env ) : min( 1 ) : max( 0 ) : lin2exp( 20, 20000 );
@@ -57,31 +59,26 @@ with
 lpf( envelope ) = ve.korg35LPF( cutoff, resonance )
 with
 {
-	fc_knob = hslider( "fc [analog: d3]", 0.5, 0, 1, 0.001 ) : si.smoo;
-	envelope_int = hslider( "fc_env_int [analog: d6]", 0, -1, 1, 0.001 ) : si.smoo;
-	resonance = hslider( "reso [analog: d5]", 0.5, 0, 10, 0.001 ) : si.smoo;
+	fc_knob = hslider( "fc [analog: d3] [smooth: block]", 0.5, 0, 1, 0.001 );
+	envelope_int = hslider( "fc_env_int [analog: d6] [smooth: block]", 0, -1, 1, 0.001 );
+	resonance = hslider( "reso [analog: d5] [smooth: block]", 0.5, 0, 10, 0.001 );
   
 	fc_env = envelope_int * envelope;
 	cutoff =  ( fc_knob + fc_env ) : min( 1 ) : max( 0 );
 };
 
-voice( note, gate ) = oscillator : filter * envelope
+// Envelope level is exported, so the firmware knows when the voice is silent
+voice( note, gate, level ) = oscillator : filter * envelope
 with
 {
 	oscillator = osc( note );
-	envelope = eg( gate );
+	envelope = eg( gate ) : level;
 	filter = lpf( feg( gate ) );
 };
 
-gate_0 = button( "gate_0" );
-gate_1 = button( "gate_1" );
-gate_2 = button( "gate_2" );
-gate_3 = button( "gate_3" );
+// A single voice - the firmware creates one instance of it for each voice of polyphony
+gate = button( "gate" );
+note = hslider( "note", 0, 0, 127, 1 );
+level = hbargraph( "level", 0, 1 );
 
-note_0 = hslider( "note_0", 0, 0, 127, 1 );
-note_1 = hslider( "note_1", 0, 0, 127, 1 );
-note_2 = hslider( "note_2", 0, 0, 127, 1 );
-note_3 = hslider( "note_3", 0, 0, 127, 1 );
-
-process = 0.25 * ( voice( note_0, gate_0 ) + voice( note_1, gate_1 ) + voice( note_2, gate_2 ) + voice( note_3, gate_3 ) );
-// process = ( voice( note_0, gate_0 ) + voice( note_1, gate_1 ) + voice( note_2, gate_2 )  ) / 3;
\ No newline at end of file
+process = 0.25 * voice( note, gate, level );
@@ -8,15 +8,15 @@ gate = button( "gate" );
 f = hslider( "f", 55, 20, 220, 0.001 ) : mid2hz;
 
 
-sel = ( hslider( "sel[analog: d8]", 8, -0.5, 30.5, 1 ) : int );
+sel = ( hslider( "sel [analog: d8] [curve: step]", 8, 0, 30, 1 ) : int );
 interp = hslider( "[analog: d7]", 0.5,  0, 1, 0.001 );
 
 
 filter = ve.moog_vcf_2b( resonance, cutoff )
 with
 {
-	fc = hslider( "fc [analog: d3]", 0.5, 0, 1, 0.001 ) : si.smoo : lin2exp( 20, 20000 );
-	resonance = hslider( "reso [analog: d5]", 0.5, 0, 1, 0.001 ) : si.smoo : lin2exp( 0.0001, 1.0 );
+	fc = hslider( "fc [analog: d3] [curve: exp] [smooth: block]", 632, 20, 20000, 0.001 );
+	resonance = hslider( "reso [analog: d5] [curve: exp] [smooth: block]", 0.01, 0.0001, 1, 0.0001 );
 	cutoff =  fc : min( 20000 ) : max( 20 );
 };
 
@@ -24,10 +24,10 @@ envelope = en.adsre( A, D, S, R, gate )
 with
 {
 	gate = button( "gate" );
-	A = hslider( "A [analog: c5]", 0.5, 0, 1, 0.001 ) : lin2exp( 0.01, 4 ) : si.smoo;
-	D = hslider( "D [analog: c6]", 0.5, 0, 1, 0.001 ) : lin2exp( 0.01, 4 ) : si.smoo;
-	S = hslider( "S [analog: c3]", 0.5, 0, 1, 0.001 ) : si.smoo;
-	R = hslider( "R [analog: c4]", 0.5, 0, 1, 0.001 ) : lin2exp( 0.01, 4 ) : si.smoo;
+	A = hslider( "A [analog: c5] [curve: exp] [smooth: block]", 0.2, 0.01, 4, 0.001 );
+	D = hslider( "D [analog: c6] [curve: exp] [smooth: block]", 0.2, 0.01, 4, 0.001 );
+	S = hslider( "S [analog: c3] [smooth: block]", 0.5, 0, 1, 0.001 );
+	R = hslider( "R [analog: c4] [curve: exp] [smooth: block]", 0.2, 0.01, 4, 0.001 );
 };
 
 process = ppg_waveform( sel, interp, os.phasor( 1, f / 2 ) ) : filter * envelope;
@@ -0,0 +1,240 @@
+#!/usr/bin/env python3
+"""
+Generates a constexpr table of DSP controls and their bindings from a C++ class
+generated by Faust, so the firmware doesn't have to look controls up by name and
+parse metadata at startup.
+
+	usage: faust_bindings.py faust/panel.hpp faust/panel_bindings.hpp
+
+Controls are listed in the order buildUserInterface( ) declares them - that's how
+the firmware matches them with pointers to their values (see faust_dsp::get_zones( )).
+Recognized bindings:
+ - [analog: c5] - the control follows an analog input (connector a-d, pin 3-10),
+ - note_N, gain_N and gate_N - the control is driven by MIDI voice N,
+ - level_N - a bargraph showing output level of voice N (e.g. its envelope), which
+   the firmware uses to tell when a released voice has gone silent.
+A DSP which declares instanced "1" is a single voice with controls named just note,
+gain, gate (and optionally level) - the firmware creates as many instances of it as
+the polyphony metadata says and only computes the ones which are sounding. In other
+DSPs, these names aren't bound.
+Analog inputs can be mapped with [curve: lin] (default), [curve: exp] (exponential,
+the range has to be positive) or [curve: step] (rounded to multiples of step above min).
+[smooth: block] makes the firmware smooth the value like si.smoo, but once per block.
+Invalid bindings are reported as errors, so they break the build.
+"""
+
+import re
+import sys
+
+# Pin number -> multiplexer input (pins 1 and 2 are VCC and GND)
+MUX_PINS = {3: 1, 4: 6, 5: 2, 6: 4, 7: 0, 8: 7, 9: 3, 10: 5}
+
+CURVES = {
+	'lin': 'CURVE_LINEAR',
+	'exp': 'CURVE_EXP',
+	'step': 'CURVE_STEP',
+}
+
+CONTROL_TYPES = {
+	'Button': 'CONTROL_BUTTON',
+	'CheckButton': 'CONTROL_BUTTON',
+	'Checkbox': 'CONTROL_BUTTON',
+	'HorizontalSlider': 'CONTROL_SLIDER',
+	'VerticalSlider': 'CONTROL_SLIDER',
+	'NumEntry': 'CONTROL_ENTRY',
+	'HorizontalBargraph': 'CONTROL_BARGRAPH',
+	'VerticalBargraph': 'CONTROL_BARGRAPH',
+}
+
+STRING = r'"((?:[^"\\]|\\.)*)"'
+NUMBER = r'\s*(?:FAUSTFLOAT\()?\s*([-+0-9.eE]+f?)\s*\)?\s*'
+DECLARE_RE = re.compile( r'ui_interface->declare\(\s*([^,]+?)\s*,\s*' + STRING + r'\s*,\s*' + STRING + r'\s*\)' )
+ADD_RE = re.compile( r'ui_interface->add(\w+)\(\s*' + STRING + r'\s*,\s*([^,)]+?)\s*(?:,(' + NUMBER + r'),(' + NUMBER + r')(?:,(' + NUMBER + r'),(' + NUMBER + r'))?)?\)' )
+META_RE = re.compile( r'm->declare\(\s*' + STRING + r'\s*,\s*' + STRING + r'\s*\)' )
+CLASS_RE = re.compile( r'class\s+(\w+)\s*:\s*public' )
+VOICE_RE = re.compile( r'^(note|gain|gate|level)(?:_(\d+))?$' )
+
+
+class BindingError( Exception ):
+	pass
+
+
+def analog_mux_index( name ):
+	"""Converts analog input name (e.g. 'c5') to index in the mux_inputs array"""
+	m = re.fullmatch( r'\s*([a-dA-D])(\d+)\s*', name )
+	if not m:
+		raise BindingError( 'invalid analog input name "%s"' % name )
+	pin = int( m.group( 2 ) )
+	if pin not in MUX_PINS:
+		raise BindingError( 'analog input "%s" - pin %d is not an input' % ( name, pin ) )
+	return ( ord( m.group( 1 ).lower( ) ) - ord( 'a' ) ) * 8 + MUX_PINS[pin]
+
+
+def float_literal( s ):
+	"""Float literal as C++ float"""
+	s = s.strip( )
+	return s if s.endswith( 'f' ) else s + 'f'
+
+
+def parse( source ):
+	"""Returns class name, global metadata and list of controls from Faust output"""
+	m = CLASS_RE.search( source )
+	if not m:
+		raise BindingError( 'no DSP class found' )
+	class_name = m.group( 1 )
+	metadata = dict( META_RE.findall( source ) )
+
+	body = source[source.find( 'buildUserInterface' ):]
+	pending = {}
+	controls = []
+
+	# Declarations and widgets in source order
+	events = [( m.start( ), 'declare', m ) for m in DECLARE_RE.finditer( body )]
+	events += [( m.start( ), 'add', m ) for m in ADD_RE.finditer( body )]
+	for _, kind, m in sorted( events, key=lambda e: e[0] ):
+		if kind == 'declare':
+			zone, key, value = m.group( 1 ), m.group( 2 ), m.group( 3 )
+			pending.setdefault( zone, [] ).append( ( key, value ) )
+			continue
+
+		widget, name, zone = m.group( 1 ), m.group( 2 ), m.group( 3 )
+		if widget not in CONTROL_TYPES:
+			continue
+		if widget in ( 'Button', 'CheckButton', 'Checkbox' ):
+			values = ['0.0f', '0.0f', '1.0f', '1.0f']
+		elif CONTROL_TYPES[widget] == 'CONTROL_BARGRAPH':
+			lo, hi = float_literal( m.group( 5 ) ), float_literal( m.group( 7 ) )
+			values = [lo, lo, hi, '0.0f']
+		else:
+			values = [float_literal( m.group( i ) ) for i in ( 5, 7, 9, 11 )]
+		controls.append( {
+			'name': name,
+			'type': CONTROL_TYPES[widget],
+			'values': values,
+			'metadata': pending.pop( zone, [] ),
+		} )
+
+	return class_name, metadata, controls
+
+
+def bind( control, polyphony, instanced ):
+	"""Returns binding type and source of a control"""
+	bindings = []
+	for key, value in control['metadata']:
+		if key == 'analog':
+			bindings.append( ( 'BINDING_ANALOG', analog_mux_index( value ) ) )
+
+	# Unnumbered voice controls are bound only in an instanced DSP
+	m = VOICE_RE.match( control['name'] )
+	if m and m.group( 2 ) and instanced:
+		raise BindingError( 'control "%s" - an instanced DSP is a single voice, its controls have no voice number' % control['name'] )
+	if m and ( m.group( 2 ) or instanced ):
+		voice = int( m.group( 2 ) or 0 )
+		if m.group( 2 ) and voice >= polyphony:
+			raise BindingError( 'control "%s" - voice %d out of range (polyphony is %d)' % ( control['name'], voice, polyphony ) )
+		bindings.append( ( 'BINDING_' + m.group( 1 ).upper( ), voice ) )
+
+	# Bargraphs are outputs - they can only be read
+	output = control['type'] == 'CONTROL_BARGRAPH'
+	for binding, _ in bindings:
+		if output and binding != 'BINDING_LEVEL':
+			raise BindingError( 'control "%s" is a bargraph, so it cannot be driven by the firmware' % control['name'] )
+		if not output and binding == 'BINDING_LEVEL':
+			raise BindingError( 'control "%s" has to be a bargraph' % control['name'] )
+
+	if len( bindings ) > 1:
+		raise BindingError( 'control "%s" has more than one binding' % control['name'] )
+	return bindings[0] if bindings else ( 'BINDING_NONE', 0 )
+
+
+def curve( control, binding ):
+	"""Returns response curve of a control"""
+	curves = [value.strip( ) for key, value in control['metadata'] if key == 'curve']
+	if not curves:
+		return 'CURVE_LINEAR'
+	if len( curves ) > 1 or curves[0] not in CURVES:
+		raise BindingError( 'control "%s" - invalid curve "%s"' % ( control['name'], ', '.join( curves ) ) )
+	if binding != 'BINDING_ANALOG':
+		raise BindingError( 'control "%s" has a curve, but is not bound to an analog input' % control['name'] )
+
+	_, lo, hi, step = [float( v.rstrip( 'f' ) ) for v in control['values']]
+	if curves[0] == 'exp' and ( lo <= 0 or hi <= 0 ):
+		raise BindingError( 'control "%s" - exponential curve needs a positive range' % control['name'] )
+	if curves[0] == 'step' and step <= 0:
+		raise BindingError( 'control "%s" - stepped curve needs a positive step' % control['name'] )
+	return CURVES[curves[0]]
+
+
+def smooth( control, binding ):
+	"""Returns true if control is smoothed by the firmware"""
+	modes = [value.strip( ) for key, value in control['metadata'] if key == 'smooth']
+	if not modes:
+		return False
+	if modes != ['block']:
+		raise BindingError( 'control "%s" - invalid smoothing "%s"' % ( control['name'], ', '.join( modes ) ) )
+	if binding != 'BINDING_ANALOG':
+		raise BindingError( 'control "%s" is smoothed, but is not bound to an analog input' % control['name'] )
+	return True
+
+
+def generate( source, source_name ):
+	class_name, metadata, controls = parse( source )
+	polyphony = int( metadata.get( 'polyphony', '0' ) or 0 ) or 1
+	guard = class_name.upper( ) + '_BINDINGS_HPP'
+
+	# Single voice DSP (note, gate...) or all voices in one DSP (note_0, gate_0...)
+	instanced = metadata.get( 'instanced', '0' ).strip( ) not in ( '', '0' )
+
+	rows = []
+	analog_count = 0
+	for c in controls:
+		try:
+			binding, src = bind( c, polyphony, instanced )
+			shape = curve( c, binding )
+			smoothed = smooth( c, binding )
+		except BindingError as ex:
+			raise BindingError( '%s: %s' % ( source_name, ex ) )
+		analog_count += binding == 'BINDING_ANALOG'
+		rows.append( '\t{"%s", %s, %s, %s, %d, %s, %s},' % ( c['name'], c['type'], ', '.join( c['values'] ), binding, src, shape, 'true' if smoothed else 'false' ) )
+
+	out = []
+	out.append( '// Generated by faust_bindings.py from %s - do not edit' % source_name )
+	out.append( '#ifndef %s' % guard )
+	out.append( '#define %s' % guard )
+	out.append( '' )
+	out.append( '#include <array>' )
+	out.append( '#include <faust_controls.hpp>' )
+	out.append( '' )
+	out.append( '//! Controls of %s in the order they are declared by buildUserInterface( )' % class_name )
+	out.append( 'static constexpr std::array<faust_control_info, %d> dsp_control_info =' % len( controls ) )
+	out.append( '{{' )
+	out += rows
+	out.append( '}};' )
+	out.append( '' )
+	out.append( '//! Number of controls bound to analog inputs' )
+	out.append( 'static constexpr int dsp_analog_binding_count = %d;' % analog_count )
+	out.append( '' )
+	out.append( '//! The DSP is a single voice instanced for each voice of polyphony' )
+	out.append( 'static constexpr bool dsp_voice_instancing = %s;' % ( 'true' if instanced else 'false' ) )
+	out.append( '' )
+	out.append( '#endif' )
+	return '\n'.join( out ) + '\n'
+
+
+def main( ):
+	if len( sys.argv ) != 3:
+		sys.exit( 'usage: %s <faust output .hpp> <bindings .hpp>' % sys.argv[0] )
+
+	with open( sys.argv[1] ) as f:
+		source = f.read( )
+	try:
+		header = generate( source, sys.argv[1] )
+	except BindingError as ex:
+		sys.exit( 'error: %s' % ex )
+
+	with open( sys.argv[2], 'w' ) as f:
+		f.write( header )
+
+
+if __name__ == '__main__':
+	main( )
@@ -0,0 +1,240 @@
+#ifndef FAUST_CONTROLS_HPP
+#define FAUST_CONTROLS_HPP
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <numeric>
+#include <cstring.hpp>
+
+/**
+	\file faust_controls.hpp
+	Flat table of DSP control parameters.
+
+	Controls are stored in parallel arrays (pointer, range, default value...) sorted
+	by name hash, so looking up a control by name is a binary search over 32-bit
+	hashes followed by a single string comparison.
+
+	Names and metadata are not copied - Faust passes string literals, so the table
+	only keeps pointers to them. Metadata of all controls lives in one shared pool
+	of key/value pairs and each control owns a contiguous range of it.
+
+	faust_control_info describes a control at compile time - constexpr tables of
+	these are generated from Faust output by faust_bindings.py.
+*/
+
+//! Type of a DSP control parameter
+enum faust_control_type : uint8_t
+{
+	CONTROL_SLIDER,
+	CONTROL_BUTTON,
+	CONTROL_ENTRY,
+	CONTROL_BARGRAPH  //!< Output of the DSP
+};
+
+//! What drives a DSP control
+enum faust_binding_type : uint8_t
+{
+	BINDING_NONE,
+	BINDING_ANALOG,  //!< Analog input (source is index in mux_inputs)
+	BINDING_NOTE,    //!< MIDI note of a voice (source is voice number)
+	BINDING_GAIN,    //!< MIDI velocity of a voice
+	BINDING_GATE,    //!< Gate of a voice
+	BINDING_LEVEL    //!< Output level of a voice, read by the firmware (bargraph)
+};
+
+//! How an analog input (0 to 1) is mapped onto the control's range - [curve: lin|exp|step]
+enum faust_curve_type : uint8_t
+{
+	CURVE_LINEAR,
+	CURVE_EXP,
+	CURVE_STEP
+};
+
+/**
+	\brief Compile-time description of a DSP control
+*/
+struct faust_control_info
+{
+	const char *name;
+	faust_control_type type;
+	float def, min, max, step;
+	faust_binding_type binding;
+	uint8_t source;
+	faust_curve_type curve;
+	bool smooth;  //!< Smoothed once per block - [smooth: block]
+};
+
+/**
+	\brief Table of DSP control parameters
+
+	Filled by add( ) and declare( ) calls while the DSP builds its UI and then
+	frozen with build( ). Controls are addressed by indices valid after build( ).
+*/
+class faust_control_table
+{
+public:
+	//! A single metadata entry of a control
+	struct metadata_entry
+	{
+		cstring key;
+		cstring value;
+	};
+
+	//! Adds a control parameter - name has to outlive the table
+	void add( faust_control_type type, const char *name, float *ptr, float def, float min, float max, float step )
+	{
+		m_name.push_back( name );
+		m_ptr.push_back( ptr );
+		m_def.push_back( def );
+		m_min.push_back( min );
+		m_max.push_back( max );
+		m_step.push_back( step );
+		m_type.push_back( type );
+	}
+
+	/**
+		Adds metadata entry for control bound to ptr. Faust declares metadata before
+		the control itself, so entries are only assigned to controls in build( ).
+	*/
+	void declare( float *ptr, const char *key, const char *value )
+	{
+		m_pending_metadata.push_back( {ptr, {key, value}} );
+	}
+
+	/**
+		Sorts controls by name hash, builds the metadata pool and releases all
+		spare memory. Metadata declared for anything that isn't a control (e.g. a
+		box, which Faust passes as null pointer) is dropped.
+	*/
+	void build( )
+	{
+		int count = size( );
+
+		// Sort by name hash
+		std::vector<uint32_t> hashes( count );
+		for ( int i = 0; i < count; i++ )
+			hashes[i] = hash( m_name[i] );
+		std::vector<int> order( count );
+		std::iota( order.begin( ), order.end( ), 0 );
+		std::stable_sort( order.begin( ), order.end( ), [&]( int a, int b ){return hashes[a] < hashes[b];} );
+
+		m_hash = hashes;
+		permute( m_hash, order );
+		permute( m_name, order );
+		permute( m_ptr, order );
+		permute( m_def, order );
+		permute( m_min, order );
+		permute( m_max, order );
+		permute( m_step, order );
+		permute( m_type, order );
+
+		// Metadata entries grouped by control
+		std::vector<std::pair<int, metadata_entry>> tagged;
+		for ( const auto &[ptr, entry] : m_pending_metadata )
+		{
+			auto it = std::find( m_ptr.begin( ), m_ptr.end( ), ptr );
+			if ( it != m_ptr.end( ) )
+				tagged.emplace_back( it - m_ptr.begin( ), entry );
+		}
+		std::stable_sort( tagged.begin( ), tagged.end( ), []( const auto &a, const auto &b ){return a.first < b.first;} );
+
+		std::vector<uint16_t>( count + 1, 0 ).swap( m_metadata_begin );
+		std::vector<metadata_entry> pool;
+		pool.reserve( tagged.size( ) );
+		for ( const auto &[index, entry] : tagged )
+		{
+			pool.push_back( entry );
+			m_metadata_begin[index + 1]++;
+		}
+		std::partial_sum( m_metadata_begin.begin( ), m_metadata_begin.end( ), m_metadata_begin.begin( ) );
+		m_metadata.swap( pool );
+		std::vector<std::pair<float*, metadata_entry>>( ).swap( m_pending_metadata );
+	}
+
+	//! Returns number of controls
+	int size( ) const
+	{
+		return m_ptr.size( );
+	}
+
+	//! Returns index of control with given name or -1 if there's none
+	int find( const cstring &name ) const
+	{
+		uint32_t h = hash( name );
+		auto it = std::lower_bound( m_hash.begin( ), m_hash.end( ), h );
+		for ( ; it != m_hash.end( ) && *it == h; ++it )
+		{
+			int index = it - m_hash.begin( );
+			if ( m_name[index] == name )
+				return index;
+		}
+		return -1;
+	}
+
+	// Control properties
+	cstring get_name( int index ) const {return m_name[index];}
+	float *get_ptr( int index ) const {return m_ptr[index];}
+	float get_def( int index ) const {return m_def[index];}
+	float get_min( int index ) const {return m_min[index];}
+	float get_max( int index ) const {return m_max[index];}
+	float get_step( int index ) const {return m_step[index];}
+	faust_control_type get_type( int index ) const {return m_type[index];}
+
+	//! Metadata range of a control
+	const metadata_entry *metadata_begin( int index ) const {return m_metadata.data( ) + m_metadata_begin[index];}
+	const metadata_entry *metadata_end( int index ) const {return m_metadata.data( ) + m_metadata_begin[index + 1];}
+
+	//! Returns value of control's metadata entry - an empty string if there's no such key
+	cstring get_metadata( int index, const cstring &key ) const
+	{
+		for ( auto it = metadata_begin( index ); it != metadata_end( index ); ++it )
+			if ( it->key == key )
+				return it->value;
+		return cstring( );
+	}
+
+	//! Returns number of heap bytes held by the table
+	size_t get_heap_size( ) const
+	{
+		return m_hash.capacity( ) * sizeof( uint32_t )
+			+ m_name.capacity( ) * sizeof( cstring )
+			+ m_ptr.capacity( ) * sizeof( float* )
+			+ ( m_def.capacity( ) + m_min.capacity( ) + m_max.capacity( ) + m_step.capacity( ) ) * sizeof( float )
+			+ m_type.capacity( ) * sizeof( faust_control_type )
+			+ m_metadata_begin.capacity( ) * sizeof( uint16_t )
+			+ m_metadata.capacity( ) * sizeof( metadata_entry )
+			+ m_pending_metadata.capacity( ) * sizeof( std::pair<float*, metadata_entry> );
+	}
+
+private:
+	static uint32_t hash( const cstring &s )
+	{
+		return std::hash<cstring>( )( s );
+	}
+
+	//! Reorders v so that v[i] = old v[order[i]] - the new vector has no spare capacity
+	template <typename T>
+	static void permute( std::vector<T> &v, const std::vector<int> &order )
+	{
+		std::vector<T> tmp;
+		tmp.reserve( order.size( ) );
+		for ( int i : order )
+			tmp.push_back( v[i] );
+		v.swap( tmp );
+	}
+
+	std::vector<uint32_t> m_hash;
+	std::vector<cstring> m_name;
+	std::vector<float*> m_ptr;
+	std::vector<float> m_def;
+	std::vector<float> m_min;
+	std::vector<float> m_max;
+	std::vector<float> m_step;
+	std::vector<faust_control_type> m_type;
+	std::vector<uint16_t> m_metadata_begin;
+	std::vector<metadata_entry> m_metadata;
+	std::vector<std::pair<float*, metadata_entry>> m_pending_metadata;
+};
+
+#endif
@@ -8,28 +8,12 @@
 #include <memory>
 #include <initializer_list>
 #include <cstring.hpp>
+#include <faust_controls.hpp>
 
 #ifndef FAUSTFLOAT
 #define FAUSTFLOAT float
 #endif 
 
-/**
-	\brief Represents DSP control parameter
-*/
-struct faust_control
-{
-	std::string name;
-	float *ptr;
-	float min, max, def, step;
-	std::unordered_map<cstring, cstring> metadata;
-	enum
-	{
-		CONTROL_SLIDER,
-		CONTROL_BUTTON,
-		CONTROL_ENTRY
-	} type;
-};
-
 /**
 	\brief Parent class of fasut_dsp_* classes
 	Provides Metadata and UI handling capabilities
@@ -63,7 +47,7 @@ protected:
 	class UI
 	{
 	public:
-		const std::unordered_map<float*, faust_control> &get_controls( ) const
+		faust_control_table &get_controls( )
 		{
 			return m_controls;
 		}
@@ -82,82 +66,99 @@ protected:
 		
 		void addButton( const char *name, float *ptr )
 		{
-			auto &ctl = m_controls[ptr];
-			ctl.name = name;
-			ctl.ptr  = ptr;
-			ctl.min  = 0;
-			ctl.max  = 1;
-			ctl.def  = 0;
-			ctl.step = 1;
-			ctl.type = faust_control::CONTROL_BUTTON;
+			add( CONTROL_BUTTON, name, ptr, 0, 0, 1, 1 );
 		}
 		
 		void addCheckbox( const char *name, float *ptr )
 		{
-			auto &ctl = m_controls[ptr];
-			ctl.name = name;
-			ctl.ptr  = ptr;
-			ctl.min  = 0;
-			ctl.max  = 1;
-			ctl.def  = 0;
-			ctl.step = 1;
-			ctl.type = faust_control::CONTROL_BUTTON;
+			add( CONTROL_BUTTON, name, ptr, 0, 0, 1, 1 );
 		}
 		
 		void addHorizontalSlider( const char *name, float *ptr, float def, float min, float max, float step )
 		{
-			auto &ctl = m_controls[ptr];
-			ctl.name = name;
-			ctl.ptr  = ptr;
-			ctl.min  = min;
-			ctl.max  = max;
-			ctl.def  = def;
-			ctl.step = step;
-			ctl.type = faust_control::CONTROL_SLIDER;
+			add( CONTROL_SLIDER, name, ptr, def, min, max, step );
 		}
 		
 		void addVerticalSlider( const char *name, float *ptr, float def, float min, float max, float step )
 		{
-			auto &ctl = m_controls[ptr];
-			ctl.name = name;
-			ctl.ptr  = ptr;
-			ctl.min  = min;
-			ctl.max  = max;
-			ctl.def  = def;
-			ctl.step = step;
-			ctl.type = faust_control::CONTROL_SLIDER;
+			add( CONTROL_SLIDER, name, ptr, def, min, max, step );
 		}
 		
 		void addNumEntry( const char *name, float *ptr, float def, float min, float max, float step )
 		{
-			auto &ctl = m_controls[ptr];
-			ctl.name = name;
-			ctl.ptr  = ptr;
-			ctl.min  = min;
-			ctl.max  = max;
-			ctl.def  = def;
-			ctl.step = step;
-			ctl.type = faust_control::CONTROL_ENTRY;
+			add( CONTROL_ENTRY, name, ptr, def, min, max, step );
+		}
+		
+		void addHorizontalBargraph( const char *name, float *ptr, float min, float max )
+		{
+			add( CONTROL_BARGRAPH, name, ptr, min, min, max, 0 );
+		}
+		
+		void addVerticalBargraph( const char *name, float *ptr, float min, float max )
+		{
+			add( CONTROL_BARGRAPH, name, ptr, min, min, max, 0 );
 		}
 		
 		void declare( float *ptr, const char *key, const char *value )
 		{
-			m_controls[ptr].metadata[key] = value;
+			if ( !m_zones )
+				m_controls.declare( ptr, key, value );
+		}
+		
+		/**
+			Makes the UI only collect value pointers (in the order of declaration)
+			instead of building the control table. At most count pointers are stored.
+		*/
+		void collect_zones( float **zones, int count )
+		{
+			m_zones = zones;
+			m_zone_capacity = count;
+		}
+		
+		//! Number of controls declared while collecting value pointers
+		int get_zone_count( ) const
+		{
+			return m_zone_count;
 		}
 		
 	private:
-		std::unordered_map<float*, faust_control> m_controls;
+		void add( faust_control_type type, const char *name, float *ptr, float def, float min, float max, float step )
+		{
+			if ( !m_zones )
+				m_controls.add( type, name, ptr, def, min, max, step );
+			else if ( m_zone_count++ < m_zone_capacity )
+				m_zones[m_zone_count - 1] = ptr;
+		}
+		
+		faust_control_table m_controls;
+		float **m_zones = nullptr;
+		int m_zone_capacity = 0;
+		int m_zone_count = 0;
 	};
 		
 public:
 	/**
-		Initializes DSP's interface and returns a map of control parameters (name -> parameter)
+		Initializes DSP's interface and returns a table of control parameters
+	*/
+	faust_control_table init_ui( )
+	{
+		UI ui;
+		buildUserInterface( &ui );
+		ui.get_controls( ).build( );
+		return std::move( ui.get_controls( ) );
+	}
+	
+	/**
+		Stores pointers to values of the controls in the order the DSP declares them
+		(at most count of them) and returns number of controls. Unlike init_ui( ),
+		this doesn't allocate any memory.
 	*/
-	std::unordered_map<float*, faust_control> init_ui( )
+	int init_zones( float **zones, int count )
 	{
 		UI ui;
+		ui.collect_zones( zones, count );
 		buildUserInterface( &ui );
-		return ui.get_controls( );
+		return ui.get_zone_count( );
 	}
 	
 	/**
@@ -181,6 +182,7 @@ public:
 	virtual void init( int samplingFreq ) = 0;
 	virtual void instanceInit( int samplingFreq ) = 0;
 	virtual int getSampleRate( ) = 0;	
+	virtual faust_dsp_base *clone( ) = 0;
 	virtual void buildUserInterface( UI* ui_interface ) = 0;
 	virtual void compute( int count, FAUSTFLOAT** inputs, FAUSTFLOAT** outputs ) = 0;
 };
@@ -189,7 +191,6 @@ public:
 /**
 	A wrapper class for faust_dsp_base. We don't need so many exposed functions and stuff.
 	Also, this class manages initialization of the DSP
-	\todo add reset functions
 */
 class faust_dsp
 {
@@ -203,13 +204,36 @@ public:
 		// Initialize the DSP
 		m_dsp->init( samplerate );
 		
-		// Get DSP controls
-		m_controls = m_dsp->init_ui( );
-		
 		// Gather metadata
 		m_metadata = m_dsp->init_metadata( );
 	}
 	
+	/**
+		Initializes the DSP again for a different sample rate (static tables and instanceInit( )).
+		All internal state is cleared and controls are reset to their default values.
+	*/
+	void set_sample_rate( int samplerate )
+	{
+		m_dsp->init( samplerate );
+	}
+	
+	//! Clears internal state of the DSP (delay lines, envelopes...), leaving controls as they are
+	void clear( )
+	{
+		m_dsp->instanceClear( );
+	}
+	
+	/**
+		Creates another instance of the DSP, initialized for the same sample rate.
+		Its controls are set to their default values.
+	*/
+	std::unique_ptr<faust_dsp_base> clone( )
+	{
+		std::unique_ptr<faust_dsp_base> dsp( m_dsp->clone( ) );
+		dsp->init( m_dsp->getSampleRate( ) );
+		return dsp;
+	}
+	
 	unsigned int get_input_count( ) {return m_dsp->getNumInputs( );}
 	unsigned int get_output_count( ) {return m_dsp->getNumOutputs( );}
 	int get_sample_rate( ) {return m_dsp->getSampleRate( );}
@@ -229,24 +253,46 @@ public:
 		m_dsp->compute( count, const_cast<FAUSTFLOAT**>( inputs.begin( ) ), const_cast<FAUSTFLOAT**>( outputs.begin( ) ) );
 	}
 	
-	const faust_control *get_control_by_name( const cstring &name )
+	//! Returns pointer to value of control with given name or nullptr if there's none
+	float *get_control_ptr_by_name( const cstring &name )
+	{
+		const faust_control_table &controls = get_controls( );
+		int index = controls.find( name );
+		return index < 0 ? nullptr : controls.get_ptr( index );
+	}
+
+	/**
+		Stores pointers to values of the controls in the order the DSP declares them,
+		which is the order of tables generated by faust_bindings.py. Throws if the
+		DSP doesn't have exactly count controls - i.e. the table is out of date.
+	*/
+	void get_zones( float **zones, int count )
 	{
-		for ( const auto &[ptr, ctl] : m_controls )
+		if ( m_dsp->init_zones( zones, count ) != count )
+			throw std::runtime_error( "DSP controls don't match the generated control table" );
+	}
+
+	/**
+		Returns table of DSP controls with names and metadata. The table is built
+		on first use - code using generated control tables never needs it.
+	*/
+	const faust_control_table &get_controls( )
+	{
+		if ( !m_controls_ready )
 		{
-			if ( ctl.name == name.c_str( ) )
-				return &ctl;
+			m_controls = m_dsp->init_ui( );
+			m_controls_ready = true;
 		}
-
-		return nullptr;
+		return m_controls;
 	}
 
-	// Metadata and controls access
-	const std::unordered_map<float*, faust_control> &get_controls( ) const {return m_controls;}
+	// Metadata access
 	const std::unordered_map<cstring, cstring> &get_metadata( ) const {return m_metadata;}
 	
 private:
 	std::unique_ptr<faust_dsp_base> m_dsp;
-	std::unordered_map<float*, faust_control> m_controls;
+	faust_control_table m_controls;
+	bool m_controls_ready = false;
 	std::unordered_map<cstring, cstring> m_metadata;
 };
 
@@ -0,0 +1,16 @@
+#ifndef HOST_DMA_H
+#define HOST_DMA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+void MX_DMA_Init( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef HOST_GPIO_H
+#define HOST_GPIO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+void MX_GPIO_Init( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,232 @@
+#include <host_sim.hpp>
+#include <usart.h>
+#include <i2c.h>
+#include <i2s.h>
+#include <dma.h>
+#include <tim.h>
+#include <adc.h>
+#include <gpio.h>
+#include <midi.hpp>
+#include <cstdio>
+#include <algorithm>
+
+/**
+	\file hal_stub.cpp
+	Simulated peripherals for the host build. Everything happens synchronously -
+	the "hardware" only makes progress when the firmware waits for an interrupt
+	in __WFI( ), which makes offline renders fully deterministic.
+*/
+
+DWT_Type host_dwt;
+uint32_t SystemCoreClock = 168000000;
+GPIO_TypeDef host_gpioa, host_gpiob, host_gpioc;
+TIM_TypeDef host_tim10;
+SPI_TypeDef host_spi2, host_i2s2ext;
+static DMA_Stream_TypeDef host_dma1_stream1;
+static DMA_Stream_TypeDef host_dma1_stream3;
+static DMA_Stream_TypeDef host_dma1_stream4;
+
+UART_HandleTypeDef huart1;
+UART_HandleTypeDef huart3;
+DMA_HandleTypeDef hdma_usart3_rx;
+DMA_HandleTypeDef hdma_spi2_tx;
+DMA_HandleTypeDef hdma_i2s2_ext_rx;
+I2C_HandleTypeDef hi2c1;
+I2S_HandleTypeDef hi2s2;
+TIM_HandleTypeDef htim10;
+ADC_HandleTypeDef hadc1, hadc2, hadc3;
+
+void host_sim_set_time( double t )
+{
+	host_dwt.CYCCNT = static_cast<uint64_t>( t * SystemCoreClock );
+}
+
+//! Receives everything played by the I2S DMA
+static std::function<void(const uint16_t*, int, int)> i2s_hook;
+
+void host_sim_set_i2s_hook( std::function<void(const uint16_t*, int, int)> hook )
+{
+	i2s_hook = hook;
+}
+
+//! Provides everything captured by the I2S2ext DMA
+static std::function<void(uint16_t*, int, int)> i2s_input_hook;
+
+void host_sim_set_i2s_input_hook( std::function<void(uint16_t*, int, int)> hook )
+{
+	i2s_input_hook = hook;
+}
+
+/**
+	Circular Rx DMA - the byte is written at the position indicated by the NDTR
+	register, which counts down and reloads, just like on the target.
+*/
+bool host_sim_uart_receive( UART_HandleTypeDef *h, uint8_t byte )
+{
+	if ( h->pRxBuffPtr == nullptr || h->hdmarx == nullptr ) return false;
+
+	DMA_Stream_TypeDef *stream = h->hdmarx->Instance;
+	h->pRxBuffPtr[h->RxXferSize - stream->NDTR] = byte;
+
+	if ( --stream->NDTR == 0 )
+	{
+		stream->NDTR = h->RxXferSize;
+		HAL_UART_RxCpltCallback( h );
+	}
+	else if ( stream->NDTR == h->RxXferSize / 2u )
+		HAL_UART_RxHalfCpltCallback( h );
+
+	return true;
+}
+
+//! Mirrors USART3_IRQHandler( ) in cubemx/Src/stm32f4xx_it.c
+void host_sim_uart_idle( UART_HandleTypeDef *h )
+{
+	if ( h == &huart3 && ( h->EnabledIT & UART_IT_IDLE ) )
+		midi_uart_idle_callback( );
+}
+
+/**
+	Waiting for an interrupt means that the I2S DMA transmits the memory
+	buffer selected by the CT bit and switches to the other one (double buffer mode).
+	Meanwhile, the I2S2ext DMA receives the same number of halfwords (if enabled).
+	Its interrupt comes after the Tx one, just like on the target.
+*/
+void __WFI( void )
+{
+	DMA_Stream_TypeDef *stream = hdma_spi2_tx.Instance;
+	if ( stream == nullptr || !( stream->CR & DMA_SxCR_EN ) || !( hi2s2.Instance->CR2 & SPI_CR2_TXDMAEN ) )
+		throw std::runtime_error( "__WFI() called with no interrupt source active" );
+
+	bool m1 = stream->CR & DMA_SxCR_CT;
+	const uint16_t *data = reinterpret_cast<const uint16_t*>( m1 ? stream->M1AR : stream->M0AR );
+	static const int datlen_bits[] = {16, 24, 32, 16};
+	int bits = datlen_bits[( hi2s2.Instance->I2SCFGR & SPI_I2SCFGR_DATLEN ) / SPI_I2SCFGR_DATLEN_0];
+	if ( i2s_hook ) i2s_hook( data, stream->NDTR, bits );
+
+	stream->CR ^= DMA_SxCR_CT;
+	if ( m1 ) hdma_spi2_tx.XferM1CpltCallback( &hdma_spi2_tx );
+	else hdma_spi2_tx.XferCpltCallback( &hdma_spi2_tx );
+
+	stream = hdma_i2s2_ext_rx.Instance;
+	if ( stream == nullptr || !( stream->CR & DMA_SxCR_EN ) || !( host_i2s2ext.CR2 & SPI_CR2_RXDMAEN ) )
+		return;
+
+	m1 = stream->CR & DMA_SxCR_CT;
+	uint16_t *input = reinterpret_cast<uint16_t*>( m1 ? stream->M1AR : stream->M0AR );
+	bits = datlen_bits[( host_i2s2ext.I2SCFGR & SPI_I2SCFGR_DATLEN ) / SPI_I2SCFGR_DATLEN_0];
+	if ( i2s_input_hook ) i2s_input_hook( input, stream->NDTR, bits );
+	else std::fill( input, input + stream->NDTR, 0 );
+
+	stream->CR ^= DMA_SxCR_CT;
+	if ( m1 ) hdma_i2s2_ext_rx.XferM1CpltCallback( &hdma_i2s2_ext_rx );
+	else hdma_i2s2_ext_rx.XferCpltCallback( &hdma_i2s2_ext_rx );
+}
+
+HAL_StatusTypeDef HAL_Init( void ) { return HAL_OK; }
+void SystemClock_Config( void ) {}
+void Error_Handler( void ) { throw std::runtime_error( "Error_Handler() called" ); }
+void HAL_Delay( uint32_t Delay ) {}
+uint32_t HAL_GetTick( void ) { return 0; }
+
+void MX_GPIO_Init( void ) {}
+void MX_DMA_Init( void ) {}
+void MX_ADC1_Init( void ) {}
+void MX_ADC2_Init( void ) {}
+void MX_ADC3_Init( void ) {}
+void MX_I2C1_Init( void ) {}
+void MX_USART1_UART_Init( void ) {}
+void MX_USART3_UART_Init( void )
+{
+	hdma_usart3_rx.Instance = &host_dma1_stream1;
+	huart3.hdmarx = &hdma_usart3_rx;
+}
+void MX_TIM10_Init( void ) { htim10.Instance = TIM10; }
+void MX_I2S2_Init( void )
+{
+	hdma_spi2_tx.Instance = &host_dma1_stream4;
+	hdma_spi2_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+	hdma_i2s2_ext_rx.Instance = &host_dma1_stream3;
+	hdma_i2s2_ext_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+	hi2s2.Instance = &host_spi2;
+	hi2s2.hdmatx = &hdma_spi2_tx;
+	hi2s2.hdmarx = &hdma_i2s2_ext_rx;
+}
+
+void HAL_GPIO_WritePin( GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState )
+{
+	if ( PinState == GPIO_PIN_SET ) GPIOx->ODR |= GPIO_Pin;
+	else GPIOx->ODR &= ~GPIO_Pin;
+}
+
+//! Every read toggles the pin, so code synchronizing to a clock (e.g. I2S WS) doesn't hang
+GPIO_PinState HAL_GPIO_ReadPin( GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin )
+{
+	GPIOx->ODR ^= GPIO_Pin;
+	return ( GPIOx->ODR & GPIO_Pin ) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT( TIM_HandleTypeDef *htim ) { return HAL_OK; }
+HAL_StatusTypeDef HAL_ADC_ConfigChannel( ADC_HandleTypeDef *hadc, ADC_ChannelConfTypeDef *sConfig ) { return HAL_OK; }
+HAL_StatusTypeDef HAL_ADC_Start_IT( ADC_HandleTypeDef *hadc ) { return HAL_OK; }
+uint32_t HAL_ADC_GetValue( ADC_HandleTypeDef *hadc ) { return hadc->Value; }
+
+//! Everything sent over UART ends up on stdout
+HAL_StatusTypeDef HAL_UART_Transmit( UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size, uint32_t Timeout )
+{
+	std::fwrite( pData, 1, Size, stdout );
+	return HAL_OK;
+}
+
+//! DMA transfers complete immediately
+HAL_StatusTypeDef HAL_UART_Transmit_DMA( UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size )
+{
+	std::fwrite( pData, 1, Size, stdout );
+	HAL_UART_TxCpltCallback( huart );
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive_DMA( UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size )
+{
+	huart->pRxBuffPtr = pData;
+	huart->RxXferSize = Size;
+	huart->hdmarx->Instance->NDTR = Size;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write( I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout )
+{
+	return HAL_OK;
+}
+
+/**
+	Same checks as in the real HAL - all transfer callbacks are required in double buffer mode.
+	The peripheral is the destination or the source, depending on the direction.
+*/
+HAL_StatusTypeDef HAL_DMAEx_MultiBufferStart_IT( DMA_HandleTypeDef *hdma, uintptr_t SrcAddress, uintptr_t DstAddress, uintptr_t SecondMemAddress, uint32_t DataLength )
+{
+	if ( hdma->XferCpltCallback == nullptr || hdma->XferM1CpltCallback == nullptr || hdma->XferErrorCallback == nullptr )
+		return HAL_ERROR;
+
+	DMA_Stream_TypeDef *stream = hdma->Instance;
+	bool to_periph = hdma->Init.Direction == DMA_MEMORY_TO_PERIPH;
+	stream->M0AR = to_periph ? SrcAddress : DstAddress;
+	stream->PAR = to_periph ? DstAddress : SrcAddress;
+	stream->M1AR = SecondMemAddress;
+	stream->NDTR = DataLength;
+	stream->CR = DMA_SxCR_DBM | DMA_SxCR_EN;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMAEx_ChangeMemory( DMA_HandleTypeDef *hdma, uintptr_t Address, HAL_DMA_MemoryTypeDef memory )
+{
+	if ( memory == MEMORY0 ) hdma->Instance->M0AR = Address;
+	else hdma->Instance->M1AR = Address;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_Abort( DMA_HandleTypeDef *hdma )
+{
+	hdma->Instance->CR = 0;
+	return HAL_OK;
+}
@@ -0,0 +1,238 @@
+#include <synth.hpp>
+#include <host_sim.hpp>
+#include <midi_file.hpp>
+#include <wav_file.hpp>
+#include <audio.hpp>
+#include <analog.hpp>
+#include <midi.hpp>
+#include <profiler.hpp>
+#include <com.hpp>
+#include <systime.hpp>
+#include <algorithm>
+#include <vector>
+#include <memory>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+/**
+	\file host_main.cpp
+	Entry point of the host (native) build. Runs synth_main( ) offline - MIDI
+	data is read from a file and fed to the simulated MIDI UART with proper
+	timing, while everything the firmware sends to the codec goes to a WAV file.
+*/
+
+static void usage( const char *name )
+{
+	std::fprintf( stderr,
+		"usage: %s [-t tail] [-k input=value]... [-a] [-i input.wav] input.mid output.wav\n"
+		"\t-t tail        - seconds rendered after the last MIDI event (default 2)\n"
+		"\t-i input.wav   - audio received from the codec's ADC (silence by default)\n"
+		"\t-k input=value - sets analog multiplexer input (0-31) to value (0-1, default 0.5)\n"
+		"\t-a             - move all MIDI channel messages to channel 0\n",
+		name );
+}
+
+int main( int argc, char **argv )
+{
+	double tail = 2.0;
+	bool remap_channels = false;
+	const char *input_path = nullptr;
+
+	// Knobs in the middle position by default
+	for ( auto &v : mux_inputs )
+		v = 0.5f;
+
+	int opt;
+	while ( ( opt = getopt( argc, argv, "t:k:ai:" ) ) != -1 )
+	{
+		switch ( opt )
+		{
+			case 't':
+				tail = std::atof( optarg );
+				break;
+
+			case 'k':
+			{
+				int input;
+				float value;
+				if ( std::sscanf( optarg, "%d=%f", &input, &value ) != 2 || input < 0 || input >= 32 )
+				{
+					usage( argv[0] );
+					return 1;
+				}
+				mux_inputs[input] = value;
+				break;
+			}
+
+			case 'a':
+				remap_channels = true;
+				break;
+
+			case 'i':
+				input_path = optarg;
+				break;
+
+			default:
+				usage( argv[0] );
+				return 1;
+		}
+	}
+
+	if ( argc - optind != 2 )
+	{
+		usage( argv[0] );
+		return 1;
+	}
+
+	try
+	{
+		auto events = midi_file_read( argv[optind] );
+		wav_writer wav( argv[optind + 1], audio_get_sample_rate( ), 2 );
+
+		if ( remap_channels )
+			for ( auto &ev : events )
+				ev.data[0] &= 0xf0;
+
+		double length = ( events.empty( ) ? 0.0 : events.back( ).time ) + tail;
+		size_t next_event = 0, next_byte = 0;
+		size_t lost_bytes = 0;
+
+		// MIDI bytes are sent one after another, so their timing depends on the baud rate
+		const double byte_time = 10.0 / MIDI_BAUD_RATE;
+		double line_free = 0; // When the last byte was received
+		bool line_busy = false; // Set until the idle interrupt fires
+
+		// Everything happens while the firmware waits for the DMA
+		std::vector<int32_t> samples;
+		host_sim_set_i2s_hook( [&]( const uint16_t *data, int size, int bits )
+		{
+			// Longer samples are sent as two halfwords, upper one first
+			samples.resize( bits == 16 ? size : size / 2 );
+			for ( size_t i = 0; i < samples.size( ); i++ )
+				samples[i] = bits == 16 ? int16_t( data[i] ) :
+					int32_t( uint32_t( data[2 * i] ) << 16 | data[2 * i + 1] ) >> ( 32 - bits );
+			wav.set_bits( bits );
+			wav.set_sample_rate( audio_get_sample_rate( ) );
+			int sample_rate = wav.get_sample_rate( );
+
+			// End of this part of the buffer - that's when the DMA interrupt happens
+			double now = double( wav.get_frame_count( ) + samples.size( ) / 2 ) / sample_rate;
+
+			// Deliver MIDI bytes received while this part of the buffer was playing
+			while ( next_event < events.size( ) )
+			{
+				const auto &ev = events[next_event];
+				double start = std::max( ev.time, line_free );
+				if ( start + byte_time >= now ) break;
+
+				// Line has been idle for one byte time since the last byte
+				if ( line_busy && start >= line_free + byte_time )
+				{
+					host_sim_set_time( line_free + byte_time );
+					host_sim_uart_idle( &midi_uart );
+				}
+
+				line_free = start + byte_time;
+				line_busy = true;
+				host_sim_set_time( line_free );
+				if ( next_byte < ev.data.size( ) )
+					lost_bytes += !host_sim_uart_receive( &midi_uart, ev.data[next_byte] );
+
+				if ( ++next_byte >= ev.data.size( ) )
+				{
+					next_byte = 0;
+					next_event++;
+				}
+			}
+
+			if ( line_busy && line_free + byte_time < now )
+			{
+				host_sim_set_time( line_free + byte_time );
+				host_sim_uart_idle( &midi_uart );
+				line_busy = false;
+			}
+
+			host_sim_set_time( now );
+
+			wav.write( samples.data( ), samples.size( ) );
+			if ( wav.get_frame_count( ) >= length * sample_rate )
+				throw host_sim_finished( );
+		} );
+
+		// Input samples are sent in the same format as the output ones
+		std::unique_ptr<wav_reader> input;
+		std::vector<float> input_frames;
+		if ( input_path )
+		{
+			input = std::make_unique<wav_reader>( input_path );
+			host_sim_set_i2s_input_hook( [&]( uint16_t *data, int size, int bits )
+			{
+				if ( input->get_sample_rate( ) != audio_get_sample_rate( ) )
+					throw std::runtime_error( "input WAV file sample rate doesn't match the DSP" );
+
+				int count = bits == 16 ? size : size / 2;
+				input_frames.resize( count );
+				input->read( input_frames.data( ), count / 2 );
+				for ( int i = 0; i < count; i++ )
+				{
+					double max = std::ldexp( 1.0, bits - 1 );
+					int32_t v = std::lrint( std::fmin( std::fmax( input_frames[i] * max, -max ), max - 1 ) );
+					if ( bits == 16 )
+						data[i] = v;
+					else
+					{
+						uint32_t u = uint32_t( v ) << ( 32 - bits );
+						data[2 * i] = u >> 16;
+						data[2 * i + 1] = u;
+					}
+				}
+			} );
+		}
+
+		// Same as on the target
+		HAL_Init( );
+		SystemClock_Config( );
+		MX_GPIO_Init( );
+		MX_DMA_Init( );
+		MX_ADC1_Init( );
+		MX_ADC2_Init( );
+		MX_ADC3_Init( );
+		MX_I2C1_Init( );
+		MX_USART1_UART_Init( );
+		MX_USART3_UART_Init( );
+		MX_TIM10_Init( );
+		audio_init( );
+		systime_init( );
+		midi_init( );
+		analog_init( 5 );
+
+		try
+		{
+			synth_main( );
+		}
+		catch ( const host_sim_finished & )
+		{
+		}
+
+		wav.close( );
+		profiler_report( audio_get_mono_batch_size( ), wav.get_sample_rate( ) );
+		int queue_min, queue_max;
+		audio_get_queue_stats( queue_min, queue_max );
+		std::fprintf( stderr, "rendered %zu frames (%.2f s), %d underruns, %d-%d periods queued, %zu MIDI bytes lost, %d console messages dropped\n",
+			wav.get_frame_count( ), double( wav.get_frame_count( ) ) / wav.get_sample_rate( ), audio_underrun_counter,
+			queue_min, queue_max, lost_bytes + midi_rx_ring.get_overflow_count( ), com_drop_counter );
+		int latency_min, latency_max;
+		audio_get_input_latency( latency_min, latency_max );
+		if ( latency_max )
+			std::fprintf( stderr, "input latency %d-%d frames, %d input overruns\n", latency_min, latency_max, audio_input_overrun_counter );
+	}
+	catch ( const std::exception &ex )
+	{
+		std::fprintf( stderr, "error: %s\n", ex.what( ) );
+		return 1;
+	}
+
+	return 0;
+}
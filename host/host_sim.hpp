@@ -0,0 +1,59 @@
+#ifndef HOST_SIM_HPP
+#define HOST_SIM_HPP
+
+#include <cinttypes>
+#include <functional>
+#include <stdexcept>
+#include <main.h>
+
+/**
+	Thrown by simulation hooks in order to leave synth_main( ) once the
+	offline render is complete.
+*/
+struct host_sim_finished : public std::exception
+{
+	const char *what( ) const noexcept override
+	{
+		return "host simulation finished";
+	}
+};
+
+/**
+	Sets function called whenever the simulated I2S DMA finishes transmitting
+	a part of the audio buffer. The hook receives raw halfwords exactly as they
+	would be sent to the codec, together with the configured I2S data length
+	(16 - one halfword per sample, 24 or 32 - two halfwords, upper one first).
+
+	The hook is called from __WFI( ), i.e. while the firmware waits for an
+	interrupt, so it's the right place to simulate passing time (e.g. deliver
+	MIDI bytes).
+*/
+extern void host_sim_set_i2s_hook( std::function<void(const uint16_t *data, int size, int bits)> hook );
+
+/**
+	Sets function providing data received by the simulated I2S2ext DMA (the codec's ADC).
+	It's called right after the I2S hook for the same number of halfwords and has to fill
+	them in the same format. Without the hook, silence is received.
+*/
+extern void host_sim_set_i2s_input_hook( std::function<void(uint16_t *data, int size, int bits)> hook );
+
+/**
+	Sets simulated time (in seconds) seen by the firmware through the DWT cycle counter.
+	Has to be called before simulating events, so they get correct timestamps.
+*/
+extern void host_sim_set_time( double t );
+
+/**
+	Delivers one byte to the simulated UART as if it was received from the line.
+	The byte is written by the simulated circular Rx DMA, which calls half/full
+	transfer callbacks. Returns false if the byte was lost (reception not started).
+*/
+extern bool host_sim_uart_receive( UART_HandleTypeDef *h, uint8_t byte );
+
+/**
+	Simulates line idle interrupt - should be called at the end of each burst
+	of bytes delivered with host_sim_uart_receive( )
+*/
+extern void host_sim_uart_idle( UART_HandleTypeDef *h );
+
+#endif
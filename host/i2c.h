@@ -0,0 +1,18 @@
+#ifndef HOST_I2C_H
+#define HOST_I2C_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+extern I2C_HandleTypeDef hi2c1;
+
+void MX_I2C1_Init( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
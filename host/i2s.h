@@ -0,0 +1,18 @@
+#ifndef HOST_I2S_H
+#define HOST_I2S_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+extern I2S_HandleTypeDef hi2s2;
+
+void MX_I2S2_Init( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef HOST_MAIN_H
+#define HOST_MAIN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "stm32f4xx.h"
+
+void Error_Handler( void );
+void SystemClock_Config( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
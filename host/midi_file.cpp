@@ -0,0 +1,199 @@
+#include <midi_file.hpp>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+
+/**
+	Simple big-endian reader for MIDI file chunks
+*/
+class midi_file_reader
+{
+public:
+	midi_file_reader( const uint8_t *begin, const uint8_t *end ) :
+		m_ptr( begin ),
+		m_end( end )
+	{
+	}
+
+	bool eof( ) const
+	{
+		return m_ptr >= m_end;
+	}
+
+	uint8_t u8( )
+	{
+		if ( eof( ) ) throw std::runtime_error( "unexpected end of MIDI file" );
+		return *m_ptr++;
+	}
+
+	uint8_t peek( ) const
+	{
+		if ( eof( ) ) throw std::runtime_error( "unexpected end of MIDI file" );
+		return *m_ptr;
+	}
+
+	uint32_t u16( )
+	{
+		uint32_t v = u8( ) << 8;
+		return v | u8( );
+	}
+
+	uint32_t u32( )
+	{
+		uint32_t v = u16( ) << 16;
+		return v | u16( );
+	}
+
+	//! Reads variable-length quantity
+	uint32_t vlq( )
+	{
+		uint32_t v = 0;
+		for ( int i = 0; i < 4; i++ )
+		{
+			uint8_t b = u8( );
+			v = ( v << 7 ) | ( b & 0x7f );
+			if ( !( b & 0x80 ) ) return v;
+		}
+		throw std::runtime_error( "invalid variable-length quantity in MIDI file" );
+	}
+
+	void skip( size_t n )
+	{
+		if ( n > static_cast<size_t>( m_end - m_ptr ) ) throw std::runtime_error( "unexpected end of MIDI file" );
+		m_ptr += n;
+	}
+
+	const uint8_t *ptr( ) const
+	{
+		return m_ptr;
+	}
+
+private:
+	const uint8_t *m_ptr;
+	const uint8_t *m_end;
+};
+
+//! Event with time in ticks - tempo events have empty data
+struct tick_event
+{
+	uint64_t tick;
+	uint32_t tempo; //!< Microseconds per quarter note (only for tempo events)
+	std::vector<uint8_t> data;
+};
+
+//! Number of data bytes following given status byte
+int midi_data_length( uint8_t status )
+{
+	switch ( status & 0xf0 )
+	{
+		case 0xc0:
+		case 0xd0:
+			return 1;
+		default:
+			return 2;
+	}
+}
+
+void read_track( midi_file_reader &r, std::vector<tick_event> &events )
+{
+	uint64_t tick = 0;
+	uint8_t running_status = 0;
+
+	while ( !r.eof( ) )
+	{
+		tick += r.vlq( );
+		uint8_t status = r.peek( );
+
+		if ( status == 0xff ) // Meta event
+		{
+			r.u8( );
+			uint8_t type = r.u8( );
+			uint32_t len = r.vlq( );
+			if ( type == 0x51 && len == 3 )
+			{
+				uint32_t tempo = r.u8( ) << 16;
+				tempo |= r.u16( );
+				events.push_back( { tick, tempo, {} } );
+			}
+			else
+				r.skip( len );
+
+			if ( type == 0x2f ) break; // End of track
+		}
+		else if ( status == 0xf0 || status == 0xf7 ) // SysEx
+		{
+			r.u8( );
+			r.skip( r.vlq( ) );
+			running_status = 0;
+		}
+		else
+		{
+			if ( status & 0x80 )
+				running_status = r.u8( );
+			else if ( !running_status )
+				throw std::runtime_error( "MIDI data byte without status in MIDI file" );
+
+			tick_event ev{ tick, 0, { running_status } };
+			for ( int i = 0; i < midi_data_length( running_status ); i++ )
+				ev.data.push_back( r.u8( ) );
+			events.push_back( std::move( ev ) );
+		}
+	}
+}
+
+}
+
+std::vector<midi_file_event> midi_file_read( const std::string &path )
+{
+	std::ifstream f( path, std::ios::binary );
+	if ( !f ) throw std::runtime_error( "cannot open MIDI file '" + path + "'" );
+	std::vector<uint8_t> bytes( ( std::istreambuf_iterator<char>( f ) ), std::istreambuf_iterator<char>( ) );
+
+	midi_file_reader r( bytes.data( ), bytes.data( ) + bytes.size( ) );
+	std::vector<tick_event> events;
+
+	// Header
+	if ( r.u32( ) != 0x4d546864 ) throw std::runtime_error( "not a MIDI file (missing MThd)" );
+	uint32_t header_len = r.u32( );
+	if ( header_len < 6 ) throw std::runtime_error( "invalid MIDI file header" );
+	r.u16( ); // Format - tracks are merged anyway
+	uint32_t track_count = r.u16( );
+	uint32_t division = r.u16( );
+	r.skip( header_len - 6 );
+
+	// Tracks
+	for ( uint32_t i = 0; i < track_count && !r.eof( ); i++ )
+	{
+		uint32_t id = r.u32( );
+		uint32_t len = r.u32( );
+		midi_file_reader chunk( r.ptr( ), r.ptr( ) + len );
+		r.skip( len );
+		if ( id == 0x4d54726b ) // MTrk
+			read_track( chunk, events );
+	}
+
+	std::stable_sort( events.begin( ), events.end( ), []( const tick_event &a, const tick_event &b ) { return a.tick < b.tick; } );
+
+	// Convert ticks to seconds
+	std::vector<midi_file_event> result;
+	uint32_t tempo = 500000;
+	uint64_t last_tick = 0;
+	double time = 0;
+
+	for ( const auto &ev : events )
+	{
+		if ( division & 0x8000 ) // SMPTE - ticks per frame * frames per second
+			time += ( ev.tick - last_tick ) / ( ( 256 - ( division >> 8 ) ) * double( division & 0xff ) );
+		else
+			time += ( ev.tick - last_tick ) * tempo * 1e-6 / division;
+		last_tick = ev.tick;
+
+		if ( ev.data.empty( ) ) tempo = ev.tempo;
+		else result.push_back( { time, ev.data } );
+	}
+
+	return result;
+}
@@ -0,0 +1,24 @@
+#ifndef HOST_MIDI_FILE_HPP
+#define HOST_MIDI_FILE_HPP
+
+#include <cinttypes>
+#include <string>
+#include <vector>
+
+/**
+	\brief A single MIDI channel message with its timestamp
+*/
+struct midi_file_event
+{
+	double time; //!< Time in seconds since the beginning of the file
+	std::vector<uint8_t> data; //!< Message bytes (always with status byte)
+};
+
+/**
+	Reads Standard MIDI File (format 0 or 1) and returns channel messages from all
+	tracks merged and sorted by time. Tempo changes are taken into account.
+	Meta events and SysEx messages are skipped.
+*/
+extern std::vector<midi_file_event> midi_file_read( const std::string &path );
+
+#endif
@@ -0,0 +1,228 @@
+#ifndef HOST_STM32F4XX_H
+#define HOST_STM32F4XX_H
+
+/*
+	Minimal stand-in for the STM32 F4 HAL used by the host (native) build.
+
+	Only the types, constants and functions actually used by the synthesizer
+	sources are provided here. Peripherals are simulated in host/hal_stub.cpp
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef enum
+{
+	HAL_OK       = 0x00U,
+	HAL_ERROR    = 0x01U,
+	HAL_BUSY     = 0x02U,
+	HAL_TIMEOUT  = 0x03U
+} HAL_StatusTypeDef;
+
+// Core registers
+typedef struct
+{
+	volatile uint32_t CTRL;
+	volatile uint32_t CYCCNT;
+} DWT_Type;
+
+extern DWT_Type host_dwt;
+#define DWT (&host_dwt)
+
+extern uint32_t SystemCoreClock;
+
+static inline void __disable_irq( void ) {}
+static inline void __enable_irq( void ) {}
+static inline uint32_t __get_PRIMASK( void ) { return 0; }
+static inline void __set_PRIMASK( uint32_t priMask ) {}
+extern void __WFI( void );
+
+// GPIO
+typedef struct
+{
+	volatile uint32_t ODR;
+} GPIO_TypeDef;
+
+typedef enum
+{
+	GPIO_PIN_RESET = 0,
+	GPIO_PIN_SET
+} GPIO_PinState;
+
+extern GPIO_TypeDef host_gpioa, host_gpiob, host_gpioc;
+#define GPIOA (&host_gpioa)
+#define GPIOB (&host_gpiob)
+#define GPIOC (&host_gpioc)
+
+#define GPIO_PIN_0  ((uint16_t)0x0001)
+#define GPIO_PIN_1  ((uint16_t)0x0002)
+#define GPIO_PIN_2  ((uint16_t)0x0004)
+#define GPIO_PIN_3  ((uint16_t)0x0008)
+#define GPIO_PIN_4  ((uint16_t)0x0010)
+#define GPIO_PIN_5  ((uint16_t)0x0020)
+#define GPIO_PIN_6  ((uint16_t)0x0040)
+#define GPIO_PIN_7  ((uint16_t)0x0080)
+#define GPIO_PIN_8  ((uint16_t)0x0100)
+#define GPIO_PIN_9  ((uint16_t)0x0200)
+#define GPIO_PIN_10 ((uint16_t)0x0400)
+#define GPIO_PIN_11 ((uint16_t)0x0800)
+#define GPIO_PIN_12 ((uint16_t)0x1000)
+#define GPIO_PIN_13 ((uint16_t)0x2000)
+#define GPIO_PIN_14 ((uint16_t)0x4000)
+#define GPIO_PIN_15 ((uint16_t)0x8000)
+
+extern void HAL_GPIO_WritePin( GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState );
+extern GPIO_PinState HAL_GPIO_ReadPin( GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin );
+
+// Timers
+typedef struct
+{
+	volatile uint32_t ARR;
+} TIM_TypeDef;
+
+typedef struct
+{
+	TIM_TypeDef *Instance;
+} TIM_HandleTypeDef;
+
+extern TIM_TypeDef host_tim10;
+#define TIM10 (&host_tim10)
+
+extern HAL_StatusTypeDef HAL_TIM_Base_Start_IT( TIM_HandleTypeDef *htim );
+extern void HAL_TIM_PeriodElapsedCallback( TIM_HandleTypeDef *htim );
+
+// ADC
+typedef struct
+{
+	uint32_t Channel;
+	uint32_t Rank;
+	uint32_t SamplingTime;
+} ADC_ChannelConfTypeDef;
+
+typedef struct
+{
+	uint32_t Value;
+} ADC_HandleTypeDef;
+
+#define ADC_CHANNEL_0            0x00000000U
+#define ADC_SAMPLETIME_480CYCLES 0x00000007U
+
+extern HAL_StatusTypeDef HAL_ADC_ConfigChannel( ADC_HandleTypeDef *hadc, ADC_ChannelConfTypeDef *sConfig );
+extern HAL_StatusTypeDef HAL_ADC_Start_IT( ADC_HandleTypeDef *hadc );
+extern uint32_t HAL_ADC_GetValue( ADC_HandleTypeDef *hadc );
+extern void HAL_ADC_ConvCpltCallback( ADC_HandleTypeDef *hadc );
+
+// DMA
+typedef struct
+{
+	volatile uint32_t CR;
+	volatile uint32_t NDTR;
+	volatile uintptr_t PAR;
+	volatile uintptr_t M0AR;
+	volatile uintptr_t M1AR;
+} DMA_Stream_TypeDef;
+
+typedef struct
+{
+	uint32_t Direction;
+} DMA_InitTypeDef;
+
+typedef struct __DMA_HandleTypeDef
+{
+	DMA_Stream_TypeDef *Instance;
+	DMA_InitTypeDef Init;
+	void ( *XferCpltCallback )( struct __DMA_HandleTypeDef *hdma );
+	void ( *XferHalfCpltCallback )( struct __DMA_HandleTypeDef *hdma );
+	void ( *XferM1CpltCallback )( struct __DMA_HandleTypeDef *hdma );
+	void ( *XferErrorCallback )( struct __DMA_HandleTypeDef *hdma );
+} DMA_HandleTypeDef;
+
+typedef enum
+{
+	MEMORY0 = 0x00U,
+	MEMORY1 = 0x01U
+} HAL_DMA_MemoryTypeDef;
+
+#define DMA_PERIPH_TO_MEMORY 0x00000000U
+#define DMA_MEMORY_TO_PERIPH (1U << 6)
+
+#define DMA_SxCR_EN  (1U << 0)
+#define DMA_SxCR_DBM (1U << 18)
+#define DMA_SxCR_CT  (1U << 19)
+
+#define __HAL_DMA_GET_COUNTER( __HANDLE__ ) ( ( __HANDLE__ )->Instance->NDTR )
+
+extern HAL_StatusTypeDef HAL_DMAEx_MultiBufferStart_IT( DMA_HandleTypeDef *hdma, uintptr_t SrcAddress, uintptr_t DstAddress, uintptr_t SecondMemAddress, uint32_t DataLength );
+extern HAL_StatusTypeDef HAL_DMAEx_ChangeMemory( DMA_HandleTypeDef *hdma, uintptr_t Address, HAL_DMA_MemoryTypeDef memory );
+extern HAL_StatusTypeDef HAL_DMA_Abort( DMA_HandleTypeDef *hdma );
+
+// UART
+typedef struct
+{
+	uint8_t *pRxBuffPtr;
+	uint16_t RxXferSize;
+	uint32_t EnabledIT;
+	DMA_HandleTypeDef *hdmarx;
+} UART_HandleTypeDef;
+
+#define UART_IT_IDLE 0x00000010U
+#define __HAL_UART_ENABLE_IT( __HANDLE__, __IT__ ) ( ( __HANDLE__ )->EnabledIT |= ( __IT__ ) )
+
+extern HAL_StatusTypeDef HAL_UART_Transmit( UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size, uint32_t Timeout );
+extern HAL_StatusTypeDef HAL_UART_Transmit_DMA( UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size );
+extern HAL_StatusTypeDef HAL_UART_Receive_DMA( UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size );
+extern void HAL_UART_TxCpltCallback( UART_HandleTypeDef *huart );
+extern void HAL_UART_RxCpltCallback( UART_HandleTypeDef *huart );
+extern void HAL_UART_RxHalfCpltCallback( UART_HandleTypeDef *huart );
+extern void HAL_UART_ErrorCallback( UART_HandleTypeDef *huart );
+
+// I2C
+typedef struct
+{
+	volatile uint32_t ErrorCode;
+} I2C_HandleTypeDef;
+
+extern HAL_StatusTypeDef HAL_I2C_Mem_Write( I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout );
+
+// I2S
+typedef struct
+{
+	volatile uint32_t CR2;
+	volatile uint32_t SR;
+	volatile uint32_t DR;
+	volatile uint32_t I2SCFGR;
+} SPI_TypeDef;
+
+extern SPI_TypeDef host_spi2, host_i2s2ext;
+#define SPI2 (&host_spi2)
+#define I2SxEXT( __INSTANCE__ ) ( &host_i2s2ext )
+
+#define SPI_CR2_RXDMAEN      (1U << 0)
+#define SPI_CR2_TXDMAEN      (1U << 1)
+#define SPI_I2SCFGR_CHLEN    (1U << 0)
+#define SPI_I2SCFGR_DATLEN_0 (1U << 1)
+#define SPI_I2SCFGR_DATLEN_1 (1U << 2)
+#define SPI_I2SCFGR_DATLEN   ( SPI_I2SCFGR_DATLEN_0 | SPI_I2SCFGR_DATLEN_1 )
+#define SPI_I2SCFGR_I2SE     (1U << 10)
+
+typedef struct
+{
+	SPI_TypeDef *Instance;
+	DMA_HandleTypeDef *hdmatx;
+	DMA_HandleTypeDef *hdmarx;
+} I2S_HandleTypeDef;
+
+// HAL core
+extern HAL_StatusTypeDef HAL_Init( void );
+extern void HAL_Delay( uint32_t Delay );
+extern uint32_t HAL_GetTick( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
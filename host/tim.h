@@ -0,0 +1,18 @@
+#ifndef HOST_TIM_H
+#define HOST_TIM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+
+extern TIM_HandleTypeDef htim10;
+
+void MX_TIM10_Init( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,171 @@
+#include <wav_file.hpp>
+#include <stdexcept>
+#include <algorithm>
+
+//! Stores little-endian integer in the buffer
+static uint8_t *put_le( uint8_t *p, uint32_t v, int bytes )
+{
+	for ( int i = 0; i < bytes; i++ )
+		*p++ = ( v >> ( 8 * i ) ) & 0xff;
+	return p;
+}
+
+//! Reads little-endian integer from the buffer
+static uint32_t get_le( const uint8_t *p, int bytes )
+{
+	uint32_t v = 0;
+	for ( int i = 0; i < bytes; i++ )
+		v |= uint32_t( p[i] ) << ( 8 * i );
+	return v;
+}
+
+wav_writer::wav_writer( const std::string &path, int sample_rate, int channels ) :
+	m_file( std::fopen( path.c_str( ), "wb" ) ),
+	m_sample_rate( sample_rate ),
+	m_channels( channels )
+{
+	if ( m_file == nullptr )
+		throw std::runtime_error( "cannot open WAV file '" + path + "' for writing" );
+	write_header( );
+}
+
+wav_writer::~wav_writer( )
+{
+	close( );
+}
+
+void wav_writer::write_header( )
+{
+	uint32_t data_size = m_samples * ( m_bits / 8 );
+	uint8_t header[44], *p = header;
+
+	p = put_le( p, 0x46464952, 4 ); // RIFF
+	p = put_le( p, 36 + data_size, 4 );
+	p = put_le( p, 0x45564157, 4 ); // WAVE
+	p = put_le( p, 0x20746d66, 4 ); // fmt
+	p = put_le( p, 16, 4 );
+	p = put_le( p, 1, 2 ); // PCM
+	p = put_le( p, m_channels, 2 );
+	p = put_le( p, m_sample_rate, 4 );
+	p = put_le( p, m_sample_rate * m_channels * ( m_bits / 8 ), 4 );
+	p = put_le( p, m_channels * ( m_bits / 8 ), 2 );
+	p = put_le( p, m_bits, 2 );
+	p = put_le( p, 0x61746164, 4 ); // data
+	p = put_le( p, data_size, 4 );
+
+	std::fseek( m_file, 0, SEEK_SET );
+	std::fwrite( header, 1, sizeof header, m_file );
+	std::fseek( m_file, 0, SEEK_END );
+}
+
+void wav_writer::set_bits( int bits )
+{
+	if ( bits == m_bits ) return;
+	if ( ( bits != 16 && bits != 24 && bits != 32 ) || m_samples != 0 )
+		throw std::runtime_error( "cannot change WAV sample length" );
+	m_bits = bits;
+}
+
+void wav_writer::set_sample_rate( int sample_rate )
+{
+	if ( sample_rate == m_sample_rate ) return;
+	if ( sample_rate <= 0 || m_samples != 0 )
+		throw std::runtime_error( "cannot change WAV sample rate" );
+	m_sample_rate = sample_rate;
+}
+
+void wav_writer::write( const int16_t *data, size_t samples )
+{
+	if ( m_bits != 16 )
+		throw std::runtime_error( "16-bit samples written to a WAV file with different sample length" );
+	if ( m_file == nullptr ) return;
+	for ( size_t i = 0; i < samples; i++ )
+	{
+		uint8_t b[2];
+		put_le( b, static_cast<uint16_t>( data[i] ), 2 );
+		std::fwrite( b, 1, 2, m_file );
+	}
+	m_samples += samples;
+}
+
+void wav_writer::write( const int32_t *data, size_t samples )
+{
+	if ( m_file == nullptr ) return;
+	for ( size_t i = 0; i < samples; i++ )
+	{
+		uint8_t b[4];
+		put_le( b, static_cast<uint32_t>( data[i] ), m_bits / 8 );
+		std::fwrite( b, 1, m_bits / 8, m_file );
+	}
+	m_samples += samples;
+}
+
+void wav_writer::close( )
+{
+	if ( m_file == nullptr ) return;
+	write_header( );
+	std::fclose( m_file );
+	m_file = nullptr;
+}
+
+wav_reader::wav_reader( const std::string &path )
+{
+	std::FILE *f = std::fopen( path.c_str( ), "rb" );
+	if ( f == nullptr )
+		throw std::runtime_error( "cannot open WAV file '" + path + "'" );
+
+	std::vector<uint8_t> data;
+	uint8_t buf[4096];
+	size_t n;
+	while ( ( n = std::fread( buf, 1, sizeof buf, f ) ) > 0 )
+		data.insert( data.end( ), buf, buf + n );
+	std::fclose( f );
+
+	if ( data.size( ) < 12 || get_le( &data[0], 4 ) != 0x46464952 || get_le( &data[8], 4 ) != 0x45564157 )
+		throw std::runtime_error( "'" + path + "' is not a WAV file" );
+
+	// Walk through the chunks
+	int channels = 0, bits = 0;
+	for ( size_t pos = 12; pos + 8 <= data.size( ); )
+	{
+		uint32_t id = get_le( &data[pos], 4 );
+		size_t size = std::min<size_t>( get_le( &data[pos + 4], 4 ), data.size( ) - pos - 8 );
+		const uint8_t *p = &data[pos + 8];
+
+		if ( id == 0x20746d66 && size >= 16 ) // fmt
+		{
+			if ( get_le( p, 2 ) != 1 )
+				throw std::runtime_error( "'" + path + "' is not a PCM WAV file" );
+			channels = get_le( p + 2, 2 );
+			m_sample_rate = get_le( p + 4, 4 );
+			bits = get_le( p + 14, 2 );
+			if ( ( channels != 1 && channels != 2 ) || ( bits != 16 && bits != 24 && bits != 32 ) )
+				throw std::runtime_error( "'" + path + "' has unsupported sample format" );
+		}
+		else if ( id == 0x61746164 && channels ) // data
+		{
+			int bytes = bits / 8;
+			size_t frames = size / ( bytes * channels );
+			m_samples.resize( 2 * frames );
+			for ( size_t i = 0; i < frames; i++ )
+				for ( int c = 0; c < 2; c++ )
+				{
+					// Left-aligned in 32 bits
+					const uint8_t *s = p + ( i * channels + ( c < channels ? c : 0 ) ) * bytes;
+					int32_t v = get_le( s, bytes ) << ( 32 - bits );
+					m_samples[2 * i + c] = v * ( 1.f / 2147483648.f );
+				}
+			return;
+		}
+
+		pos += 8 + size + ( size & 1 );
+	}
+
+	throw std::runtime_error( "'" + path + "' has no audio data" );
+}
+
+void wav_reader::read( float *dest, size_t frames )
+{
+	for ( size_t i = 0; i < 2 * frames; i++, m_pos++ )
+		dest[i] = m_pos < m_samples.size( ) ? m_samples[m_pos] : 0.f;
+}
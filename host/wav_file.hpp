@@ -0,0 +1,81 @@
+#ifndef HOST_WAV_FILE_HPP
+#define HOST_WAV_FILE_HPP
+
+#include <cinttypes>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+	\brief Writes 16, 24 or 32-bit PCM WAV files
+*/
+class wav_writer
+{
+public:
+	wav_writer( const std::string &path, int sample_rate, int channels );
+	~wav_writer( );
+
+	wav_writer( const wav_writer & ) = delete;
+	wav_writer &operator=( const wav_writer & ) = delete;
+
+	//! Sets sample length - has to be called before any samples are written
+	void set_bits( int bits );
+
+	//! Sets sample rate - has to be called before any samples are written
+	void set_sample_rate( int sample_rate );
+
+	//! Writes interleaved samples (samples = frames * channels)
+	void write( const int16_t *data, size_t samples );
+
+	//! Writes interleaved right-aligned samples of the current sample length
+	void write( const int32_t *data, size_t samples );
+
+	//! Updates header and closes the file
+	void close( );
+
+	size_t get_frame_count( ) const
+	{
+		return m_samples / m_channels;
+	}
+
+	int get_sample_rate( ) const
+	{
+		return m_sample_rate;
+	}
+
+private:
+	void write_header( );
+
+	std::FILE *m_file;
+	int m_sample_rate;
+	int m_channels;
+	int m_bits = 16;
+	size_t m_samples = 0;
+};
+
+/**
+	\brief Reads 16, 24 or 32-bit PCM WAV files (mono or stereo)
+*/
+class wav_reader
+{
+public:
+	wav_reader( const std::string &path );
+
+	int get_sample_rate( ) const
+	{
+		return m_sample_rate;
+	}
+
+	/**
+		Returns next frames stereo frames as interleaved float samples in [-1; 1).
+		Mono files have the same sample in both channels. Silence is returned past the end.
+	*/
+	void read( float *dest, size_t frames );
+
+private:
+	std::vector<float> m_samples; //!< Interleaved stereo
+	int m_sample_rate = 0;
+	size_t m_pos = 0;
+};
+
+#endif
@@ -1,33 +1,88 @@
 #include <midi.hpp>
-#include <algorithm>
+#include <systime.hpp>
 
 /**
 	Buffer for received MIDI commands
 */
-volatile uint8_t midi_data[MIDI_BUFFER_SIZE];
-volatile uint8_t midi_byte;
-volatile int midi_data_size = 0;
+spsc_ring<midi_rx_byte, MIDI_BUFFER_SIZE> midi_rx_ring;
+
+//! Circular buffer filled by the UART Rx DMA
+static uint8_t midi_dma_buffer[MIDI_DMA_BUFFER_SIZE];
+
+//! Position in midi_dma_buffer up to which data has been moved to midi_rx_ring
+static uint32_t midi_dma_read_pos = 0;
+
+//! Time it takes to receive one byte (10 bits) in systime ticks
+static uint32_t midi_byte_ticks = 0;
+
+/**
+	Moves bytes written by the DMA since the last call to midi_rx_ring.
+
+	All bytes of a burst are published at once, so their timestamps are
+	reconstructed backwards from the current time based on the baud rate.
+	The line idle interrupt fires one byte time after the last byte was received.
+*/
+static void midi_dma_collect( bool idle )
+{
+	uint32_t now = systime_now( );
+	uint32_t write_pos = ( MIDI_DMA_BUFFER_SIZE - __HAL_DMA_GET_COUNTER( midi_uart.hdmarx ) ) & ( MIDI_DMA_BUFFER_SIZE - 1 );
+	uint32_t count = ( write_pos - midi_dma_read_pos ) & ( MIDI_DMA_BUFFER_SIZE - 1 );
+
+	for ( uint32_t i = 0; i < count; i++ )
+	{
+		uint32_t age = count - 1 - i + idle;
+		midi_rx_ring.push( {midi_dma_buffer[midi_dma_read_pos], now - age * midi_byte_ticks} );
+		midi_dma_read_pos = ( midi_dma_read_pos + 1 ) & ( MIDI_DMA_BUFFER_SIZE - 1 );
+	}
+}
+
+/**
+	Starts circular DMA reception from MIDI UART and enables line idle interrupt
+*/
+static void midi_receive( )
+{
+	midi_dma_read_pos = 0;
+	HAL_UART_Receive_DMA( &midi_uart, midi_dma_buffer, MIDI_DMA_BUFFER_SIZE );
+	__HAL_UART_ENABLE_IT( &midi_uart, UART_IT_IDLE );
+}
 
 /**
-	Informs HAL to receive one more byte from MIDI UART
+	Called from USART3_IRQHandler( ) when the MIDI line goes idle, i.e. at the end
+	of every burst of MIDI data
 */
-static inline void midi_receive( )
+void midi_uart_idle_callback( )
 {
-	HAL_UART_Receive_IT( &midi_uart, const_cast<uint8_t*>( &midi_byte ), 1 );
+	midi_dma_collect( true );
 }
 
 /**
-	General UART Rx complete interrupt. It's here because it's only used for USART3
+	Rx DMA half transfer interrupt - collects data in the middle of long bursts,
+	so the DMA never overwrites bytes that haven't been read yet
+*/
+void HAL_UART_RxHalfCpltCallback( UART_HandleTypeDef *h )
+{
+	if ( h == &midi_uart )
+		midi_dma_collect( false );
+}
+
+/**
+	Rx DMA transfer complete interrupt - the DMA wraps around to the start of the buffer
 */
 void HAL_UART_RxCpltCallback( UART_HandleTypeDef *h )
+{
+	if ( h == &midi_uart )
+		midi_dma_collect( false );
+}
+
+/**
+	UART errors (overrun, framing, noise) abort DMA reception in HAL, so it has to be restarted.
+	Whatever was received before the error is kept.
+*/
+void HAL_UART_ErrorCallback( UART_HandleTypeDef *h )
 {
 	if ( h == &midi_uart )
 	{
-		// Write the new byte into the buffer
-		if ( midi_data_size < MIDI_BUFFER_SIZE )
-			midi_data[midi_data_size++] = midi_byte;
-		
-		// Receive another byte
+		midi_dma_collect( false );
 		midi_receive( );
 	}
 }
@@ -37,7 +92,7 @@ void HAL_UART_RxCpltCallback( UART_HandleTypeDef *h )
 */
 void midi_init( )
 {
-	midi_data_size = 0;
+	midi_byte_ticks = systime_ticks_per_second( ) / ( MIDI_BAUD_RATE / 10 );
 	midi_receive( );
 }
 
@@ -126,17 +181,8 @@ void midi_interpreter::push( uint8_t b )
 
 
 polyphony_controller::polyphony_controller( int n ) :
-	m_polyphony( n ),
-	m_idle( n ),
-	m_voice_notes( n, 0 ),
-	m_voice_gains( n, 0 ),
-	m_voice_gates( n, 0 )
+	m_voices( n )
 {
-	for ( int i = 0; i < 128; i++ )
-		m_key_voice_map[i] = -1;
-
-	for ( int i = 0; i < m_polyphony; i++ )
-		m_idle.push_back( i );
 }
 
 //! MIDI Note ON event handler
@@ -148,25 +194,8 @@ void polyphony_controller::midi_note_on( int key, int velocity )
 	// Prevent playing the same note twice
 	this->midi_note_off( key, 0 );
 
-	// Get one oscillator
-	int id;
-	if ( m_idle.size( ) )
-	{
-		id = m_idle.front( );
-		m_idle.pop_front( ); // Pop an idle voice
-	}
-	else
-	{		
-		id = m_busy.front( );
-		m_busy.pop_front( ); // Pop one from the busy queue
-		m_key_voice_map[static_cast<int>( m_voice_notes[id] )] = -1; // Unmap
-	}
-
-	// Mark as busy
-	m_busy.push_back( id );
-
-	// Register what voice is mapped to certain key
-	m_key_voice_map[key] = id;
+	// Get one voice - an idle one or the oldest busy one
+	int id = m_voices.note_on( key );
 
 	// Update parameters passed to Faust
 	m_voice_notes[id] = key;
@@ -180,18 +209,9 @@ void polyphony_controller::midi_note_off( int key, int velocity )
 	// Verify key number
 	if ( key < 0 || key > 127 ) return;
 
-	// Remove the voice from the key-voice map
-	int id = m_key_voice_map[key];
-	m_key_voice_map[key] = -1;
-	if ( id < 0 ) return;
-
 	// Mark the voice as idle
-	auto new_end = std::remove( m_busy.begin( ), m_busy.end( ), id );
-	if ( new_end != m_busy.end( ) )
-	{
-		m_busy.erase( new_end, m_busy.end( ) );
-		m_idle.push_back( id );
-	}
+	int id = m_voices.note_off( key );
+	if ( id < 0 ) return;
 
 	// Update parameters passed to Faust
 	m_voice_gates[id] = 0.f;
@@ -200,11 +220,7 @@ void polyphony_controller::midi_note_off( int key, int velocity )
 //! Turn off all notes
 void polyphony_controller::reset( )
 {
-	while ( !m_busy.empty( ) )
-	{
-		int id = m_busy.front( );
-		m_busy.pop_front( );
-		m_idle.push_back( id );
-	}
+	m_voices.reset( );
+	m_voice_gates.fill( 0.f );
 }
 
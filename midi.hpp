@@ -3,7 +3,9 @@
 
 #include <usart.h>
 #include <functional>
-#include <deque>
+#include <array>
+#include <spsc_ring.hpp>
+#include <voice_allocator.hpp>
 
 /**
 	Base class for all kinds of MIDI controllers. Contains member functions called upon
@@ -71,8 +73,19 @@ private:
 	uint8_t m_channel_filter; //!< Current channel
 };
 
+//! Max number of voices handled by polyphony_controller
+#define MIDI_MAX_POLYPHONY 16
+
+//! Controller which requests a profiler report with a non-zero value (undefined in the MIDI specification)
+#ifndef MIDI_REPORT_CC
+#define MIDI_REPORT_CC 119
+#endif
+
 /**
 	\brief Manages N voices of polyphony based on MIDI Note ON/OFF commands
+
+	Voices are assigned by voice_allocator, so no event costs more than O(1)
+	and nothing is allocated after construction.
 */
 class polyphony_controller
 {
@@ -83,11 +96,23 @@ public:
 	void midi_note_off( int key, int velocity );
 	void reset( );
 
+	//! Passes output levels of the voices to the allocator - see voice_allocator::set_levels( )
+	void set_voice_levels( const float *levels )
+	{
+		m_voices.set_levels( levels );
+	}
+
 	int get_polyphony( ) const
 	{
-		return m_polyphony;
+		return m_voices.size( );
 	}	
 
+	//! Returns true if voice is playing a note or is released, but not silent yet
+	bool is_voice_active( int n ) const
+	{
+		return m_voices.is_active( n );
+	}
+
 	std::function<void(int, int)> get_note_on_lambda( )
 	{
 		return [&]( int key, int velocity ) { this->midi_note_on( key, velocity ); };
@@ -114,22 +139,13 @@ public:
 	}
 
 private:
-	int m_polyphony; //!< Number of voices
-
-	//! Currently idle voices
-	std::deque<int> m_idle;
-
-	//! Queue of busy voices
-	std::deque<int> m_busy;
-
-	//! Key-voice mappings - each field corresponds to a MIDI note number
-	//! Values are voice IDs. -1 means no mapping
-	int m_key_voice_map[128];
+	//! Key-voice mappings and the idle/busy voice lists
+	voice_allocator<MIDI_MAX_POLYPHONY> m_voices;
 
 	// These will be passed to Faust DSP
-	std::vector<float> m_voice_notes;
-	std::vector<float> m_voice_gains;
-	std::vector<float> m_voice_gates;
+	std::array<float, MIDI_MAX_POLYPHONY> m_voice_notes = {};
+	std::array<float, MIDI_MAX_POLYPHONY> m_voice_gains = {};
+	std::array<float, MIDI_MAX_POLYPHONY> m_voice_gates = {};
 };
 
 /**
@@ -156,9 +172,23 @@ public:
 	{ m_bend = ( value - 8192 ) * ( 1.f / 8192.f ); }
 	
 	virtual void program_change( int program ) {}
-	virtual void controller_change( int controller, int value ) {}
 
+	virtual void controller_change( int controller, int value )
+	{ if ( controller == MIDI_REPORT_CC && value ) m_report_requested = true; }
 
+	//! Returns true (once) if a report has been requested with MIDI_REPORT_CC
+	bool take_report_request( )
+	{
+		bool requested = m_report_requested;
+		m_report_requested = false;
+		return requested;
+	}
+
+	void set_voice_levels( const float *levels )
+	{ m_poly.set_voice_levels( levels ); }
+
+	bool is_voice_active( int n ) const
+	{ return m_poly.is_voice_active( n ); }
 
 	float get_voice_note( int n ) const
 	{
@@ -179,17 +209,34 @@ private:
 	polyphony_controller m_poly;
 	float m_bend = 0.f;
 	float m_bend_intensity = 2.f;
+	bool m_report_requested = false;
 };
 
 //! Peripheral alias
 static UART_HandleTypeDef &midi_uart = huart3;
 
-#define MIDI_BUFFER_SIZE 32
+//! Capacity of the receive buffer - has to be a power of two
+#define MIDI_BUFFER_SIZE 256
+
+//! Size of the circular UART Rx DMA buffer - has to be a power of two
+#define MIDI_DMA_BUFFER_SIZE 64
+
+#define MIDI_BAUD_RATE 31250
+
+/**
+	Received MIDI byte along with its systime_now( ) arrival time
+*/
+struct midi_rx_byte
+{
+	uint8_t byte;
+	uint32_t timestamp;
+};
 
-extern volatile int midi_data_size;
-extern volatile uint8_t midi_data[MIDI_BUFFER_SIZE];
+//! Filled by the UART and Rx DMA interrupts, emptied by the main loop
+extern spsc_ring<midi_rx_byte, MIDI_BUFFER_SIZE> midi_rx_ring;
 
 
 extern void midi_init( );
+extern void midi_uart_idle_callback( );
 
 #endif
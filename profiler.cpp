@@ -0,0 +1,129 @@
+#include <profiler.hpp>
+#include <systime.hpp>
+#include <com.hpp>
+
+//! All probes ever created (probes are global objects, so there's no need to unregister them)
+static profiler_probe *profiler_probes[PROFILER_MAX_PROBES];
+static int profiler_probe_count = 0;
+
+profiler_probe::profiler_probe( const char *name ) :
+	m_name( name )
+{
+	reset( );
+	if ( profiler_probe_count < PROFILER_MAX_PROBES )
+		profiler_probes[profiler_probe_count++] = this;
+}
+
+/**
+	Returns histogram bin number for given tick count. Values smaller than PROFILER_SUBBINS
+	get their own bins, the rest is split into PROFILER_SUBBINS bins per octave.
+*/
+int profiler_probe::bin_index( uint32_t ticks )
+{
+	if ( ticks < PROFILER_SUBBINS ) return ticks;
+	int msb = 31 - __builtin_clz( ticks );
+	int sub = ( ticks >> ( msb - PROFILER_SUBBINS_LOG2 ) ) & ( PROFILER_SUBBINS - 1 );
+	return ( msb - PROFILER_SUBBINS_LOG2 + 1 ) * PROFILER_SUBBINS + sub;
+}
+
+//! Returns the largest tick count that falls into given bin
+uint32_t profiler_probe::bin_upper_bound( int bin )
+{
+	if ( bin < PROFILER_SUBBINS ) return bin;
+	int shift = bin / PROFILER_SUBBINS - 1;
+	uint32_t lower = uint32_t( PROFILER_SUBBINS + bin % PROFILER_SUBBINS ) << shift;
+	return lower + ( ( 1u << shift ) - 1 );
+}
+
+void profiler_probe::record( uint32_t ticks )
+{
+	m_count++;
+	m_sum += ticks;
+	if ( ticks < m_min ) m_min = ticks;
+	if ( ticks > m_max ) m_max = ticks;
+	m_histogram[bin_index( ticks )]++;
+}
+
+void profiler_probe::reset( )
+{
+	m_count = 0;
+	m_min = UINT32_MAX;
+	m_max = 0;
+	m_sum = 0;
+	for ( auto &h : m_histogram )
+		h = 0;
+}
+
+/**
+	Returns (approximate) p-th percentile of recorded values. p shall be in range [0; 1].
+	The result is upper bound of the histogram bin, but never exceeds the maximum.
+*/
+uint32_t profiler_probe::get_percentile( float p ) const
+{
+	if ( !m_count ) return 0;
+
+	uint64_t target = uint64_t( p * m_count );
+	if ( target >= m_count ) target = m_count - 1;
+
+	uint64_t n = 0;
+	for ( int i = 0; i < PROFILER_BINS; i++ )
+	{
+		n += m_histogram[i];
+		if ( n > target )
+			return bin_upper_bound( i ) < m_max ? bin_upper_bound( i ) : m_max;
+	}
+
+	return m_max;
+}
+
+/**
+	Enables the cycle counter on the target. It's not reset, because it's
+	also used for timestamping MIDI data (see systime.hpp).
+*/
+void profiler_init( )
+{
+	systime_init( );
+}
+
+//! Returns number of profiler ticks per second
+uint32_t profiler_ticks_per_second( )
+{
+#ifdef SYNTH_HOST
+	return 1000000000;
+#else
+	return SystemCoreClock;
+#endif
+}
+
+/**
+	Prints statistics of all probes. All probes are assumed to be executed once per
+	audio block, so their sum is compared against the time available for one block
+	of block_size samples.
+*/
+void profiler_report( int block_size, int sample_rate )
+{
+	float budget = float( profiler_ticks_per_second( ) ) * block_size / sample_rate;
+	float total_avg = 0, total_p99 = 0;
+
+	comprintf( "%-20s %8s %10s %10s %10s %10s\n", "probe", "count", "min", "avg", "max", "p99" );
+	for ( int i = 0; i < profiler_probe_count; i++ )
+	{
+		const profiler_probe &p = *profiler_probes[i];
+		uint32_t p99 = p.get_percentile( 0.99f );
+		comprintf( "%-20s %8" PRIu32 " %10" PRIu32 " %10.0f %10" PRIu32 " %10" PRIu32 "\n",
+			p.get_name( ), p.get_count( ), p.get_min( ), p.get_average( ), p.get_max( ), p99 );
+
+		total_avg += p.get_average( );
+		total_p99 += p99;
+	}
+
+	comprintf( "block budget: %.0f ticks (%d samples @ %d Hz), load: %.1f%% avg, %.1f%% p99, headroom: %.1f%%\n",
+		budget, block_size, sample_rate, 100.f * total_avg / budget, 100.f * total_p99 / budget, 100.f * ( 1.f - total_avg / budget ) );
+}
+
+//! Resets all probes
+void profiler_reset( )
+{
+	for ( int i = 0; i < profiler_probe_count; i++ )
+		profiler_probes[i]->reset( );
+}
@@ -0,0 +1,122 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <cinttypes>
+
+#ifdef SYNTH_HOST
+#include <chrono>
+#else
+#include <stm32f4xx.h>
+#endif
+
+//! Number of histogram bins per octave - has to be a power of two
+#define PROFILER_SUBBINS_LOG2 3
+#define PROFILER_SUBBINS ( 1 << PROFILER_SUBBINS_LOG2 )
+
+//! Enough bins to cover entire 32-bit range
+#define PROFILER_BINS ( ( 32 - PROFILER_SUBBINS_LOG2 + 1 ) * PROFILER_SUBBINS )
+
+//! Max number of probes included in the report
+#define PROFILER_MAX_PROBES 16
+
+//! Report interval in seconds used by synth_main( ) - 0 disables periodic reports (reports can still be requested with MIDI_REPORT_CC)
+#ifndef PROFILER_REPORT_INTERVAL
+#define PROFILER_REPORT_INTERVAL 0
+#endif
+
+/**
+	Returns current timestamp in profiler ticks. These are CPU cycles (DWT cycle counter)
+	on the target and nanoseconds on the host. The value wraps around, so only
+	differences between timestamps are meaningful.
+*/
+static inline uint32_t profiler_timestamp( )
+{
+#ifdef SYNTH_HOST
+	return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now( ).time_since_epoch( ) ).count( );
+#else
+	return DWT->CYCCNT;
+#endif
+}
+
+/**
+	\brief Collects execution time statistics of a piece of code
+
+	Instead of storing samples, the probe keeps a histogram with logarithmic bins
+	(PROFILER_SUBBINS per octave), so percentiles are accurate to about 10%
+	and no memory is allocated. Recording a sample costs a few dozen cycles.
+*/
+class profiler_probe
+{
+public:
+	profiler_probe( const char *name );
+
+	void record( uint32_t ticks );
+	void reset( );
+
+	const char *get_name( ) const
+	{
+		return m_name;
+	}
+
+	uint32_t get_count( ) const
+	{
+		return m_count;
+	}
+
+	uint32_t get_min( ) const
+	{
+		return m_count ? m_min : 0;
+	}
+
+	uint32_t get_max( ) const
+	{
+		return m_max;
+	}
+
+	float get_average( ) const
+	{
+		return m_count ? float( m_sum ) / m_count : 0.f;
+	}
+
+	uint32_t get_percentile( float p ) const;
+
+private:
+	static int bin_index( uint32_t ticks );
+	static uint32_t bin_upper_bound( int bin );
+
+	const char *m_name;
+	uint32_t m_count;
+	uint32_t m_min;
+	uint32_t m_max;
+	uint64_t m_sum;
+	uint32_t m_histogram[PROFILER_BINS];
+};
+
+/**
+	\brief Records time spent in a scope
+*/
+class profiler_scope
+{
+public:
+	profiler_scope( profiler_probe &probe ) :
+		m_probe( probe ),
+		m_start( profiler_timestamp( ) )
+	{
+	}
+
+	~profiler_scope( )
+	{
+		m_probe.record( profiler_timestamp( ) - m_start );
+	}
+
+private:
+	profiler_probe &m_probe;
+	uint32_t m_start;
+};
+
+extern void profiler_init( );
+extern uint32_t profiler_ticks_per_second( );
+extern void profiler_report( int block_size, int sample_rate );
+extern void profiler_reset( );
+
+#endif
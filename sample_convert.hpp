@@ -0,0 +1,504 @@
+#ifndef SAMPLE_CONVERT_HPP
+#define SAMPLE_CONVERT_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <fast_math_block.hpp>
+
+#if defined( __AVX2__ ) || defined( __AVX512BW__ )
+// GCC 12 AVX-512 intrinsics start from _mm512_undefined( ), which -Wmaybe-uninitialized reports
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#include <immintrin.h>
+#pragma GCC diagnostic pop
+#elif defined( __SSE2__ )
+#include <emmintrin.h>
+#endif
+
+/**
+	\file sample_convert.hpp
+	Conversion of float samples to 16-bit stereo frames sent to the codec (and back for
+	frames received from the codec's ADC).
+	Each frame is a 32-bit word - left sample in the low halfword, right one in the high
+	halfword, which is exactly what the I2S DMA reads in halfword mode. Storing whole
+	frames halves the number of stores compared to writing samples one by one.
+
+	Samples are rounded to nearest and saturated to the 16-bit range without branches:
+	 - on Cortex-M4 with VCVTR (uses FPSCR rounding mode) and SSAT, four frames per
+	   iteration, each packed with one PKHBT,
+	 - with SSE2 (AVX2, AVX-512) 4 (8, 16) samples per instruction - CVTPS2DQ rounds
+	   (MXCSR rounding mode) and PACKSSDW saturates and packs samples into halfwords,
+	 - elsewhere with min/max and float bit tricks.
+
+	24-bit and 32-bit samples take two halfwords each (most significant one first), so
+	these formats use two words per frame - see sample_convert_wide_word( ).
+
+	Optional TPDF dither (+-1 LSB, triangular distribution) is added before rounding.
+	Random numbers come from a hash of a sample counter rather than from a sequential
+	generator, so there's no dependency between iterations and dithered loops vectorize too.
+*/
+
+//! Float sample value corresponding to 1 LSB is 1 / SAMPLE_CONVERT_SCALE
+#define SAMPLE_CONVERT_SCALE 32768.f
+
+//! TPDF dither state - number of random values used so far
+struct sample_dither
+{
+	uint32_t counter = 0;
+};
+
+//! Integer hash used as random number generator (two multiply-xorshift rounds)
+static inline uint32_t sample_dither_hash( uint32_t n )
+{
+	n *= 0x9e3779b1;
+	n ^= n >> 15;
+	n *= 0x2c1b3c6d;
+	n ^= n >> 12;
+	return n;
+}
+
+/**
+	Returns n-th value of TPDF dither in (-1; 1) LSB - sum of two 16-bit uniform
+	random numbers taken from one hash
+*/
+static inline float sample_dither_tpdf( uint32_t n )
+{
+	uint32_t r = sample_dither_hash( n );
+	return float( int32_t( r & 0xffff ) + int32_t( r >> 16 ) - 0xffff ) * ( 1.f / 65536.f );
+}
+
+/**
+	Converts a float sample (already scaled by SAMPLE_CONVERT_SCALE) to a 16-bit integer.
+	Rounds to nearest and saturates.
+*/
+static inline int32_t sample_convert_scaled( float x )
+{
+#if defined( __ARM_ARCH_7EM__ ) && defined( __ARM_FP )
+	float f;
+	int32_t i, s;
+	asm( "vcvtr.s32.f32 %0, %1" : "=t"( f ) : "t"( x ) );
+	std::memcpy( &i, &f, sizeof i );
+	asm( "ssat %0, #16, %1" : "=r"( s ) : "r"( i ) );
+	return s;
+#else
+	// Adding 1.5 * 2^23 leaves the integer part of x in the low mantissa bits (rounded to nearest even)
+	x = fminf( fmaxf( x, -32768.f ), 32767.f );
+	return fast_math_float_bits_to_int( x + 12582912.f ) - 0x4b400000;
+#endif
+}
+
+//! Packs left and right samples into a frame
+static inline uint32_t sample_convert_pack( int32_t l, int32_t r )
+{
+#if defined( __ARM_ARCH_7EM__ )
+	uint32_t f;
+	asm( "pkhbt %0, %1, %2, lsl #16" : "=r"( f ) : "r"( l ), "r"( r ) );
+	return f;
+#else
+	return uint16_t( l ) | ( uint32_t( r ) << 16 );
+#endif
+}
+
+#if defined( __AVX512BW__ )
+//! sample_dither_tpdf( ) of n to n + 15
+static inline __m512 sample_dither_tpdf16( uint32_t n )
+{
+	__m512i r = _mm512_add_epi32( _mm512_set1_epi32( n ), _mm512_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 ) );
+	r = _mm512_mullo_epi32( r, _mm512_set1_epi32( 0x9e3779b1 ) );
+	r = _mm512_xor_si512( r, _mm512_srli_epi32( r, 15 ) );
+	r = _mm512_mullo_epi32( r, _mm512_set1_epi32( 0x2c1b3c6d ) );
+	r = _mm512_xor_si512( r, _mm512_srli_epi32( r, 12 ) );
+	__m512i t = _mm512_add_epi32( _mm512_and_si512( r, _mm512_set1_epi32( 0xffff ) ), _mm512_srli_epi32( r, 16 ) );
+	t = _mm512_sub_epi32( t, _mm512_set1_epi32( 0xffff ) );
+	return _mm512_mul_ps( _mm512_cvtepi32_ps( t ), _mm512_set1_ps( 1.f / 65536.f ) );
+}
+
+//! Sixteen samples converted like with sample_convert_scaled4( ) below
+static inline __m512i sample_convert_scaled16( __m512 x )
+{
+	return _mm512_cvtps_epi32( _mm512_min_ps( _mm512_set1_ps( 32767.f ), x ) );
+}
+
+//! Loads sixteen samples, scales them and adds dither values counter to counter + 15
+template <bool dither>
+static inline __m512 sample_convert_load16( const float *src, uint32_t counter )
+{
+	__m512 x = _mm512_mul_ps( _mm512_loadu_ps( src ), _mm512_set1_ps( SAMPLE_CONVERT_SCALE ) );
+	return dither ? _mm512_add_ps( x, sample_dither_tpdf16( counter ) ) : x;
+}
+#elif defined( __AVX2__ )
+//! sample_dither_tpdf( ) of n to n + 7
+static inline __m256 sample_dither_tpdf8( uint32_t n )
+{
+	__m256i r = _mm256_add_epi32( _mm256_set1_epi32( n ), _mm256_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7 ) );
+	r = _mm256_mullo_epi32( r, _mm256_set1_epi32( 0x9e3779b1 ) );
+	r = _mm256_xor_si256( r, _mm256_srli_epi32( r, 15 ) );
+	r = _mm256_mullo_epi32( r, _mm256_set1_epi32( 0x2c1b3c6d ) );
+	r = _mm256_xor_si256( r, _mm256_srli_epi32( r, 12 ) );
+	__m256i t = _mm256_add_epi32( _mm256_and_si256( r, _mm256_set1_epi32( 0xffff ) ), _mm256_srli_epi32( r, 16 ) );
+	t = _mm256_sub_epi32( t, _mm256_set1_epi32( 0xffff ) );
+	return _mm256_mul_ps( _mm256_cvtepi32_ps( t ), _mm256_set1_ps( 1.f / 65536.f ) );
+}
+
+//! Eight samples converted like with sample_convert_scaled4( ) below
+static inline __m256i sample_convert_scaled8( __m256 x )
+{
+	return _mm256_cvtps_epi32( _mm256_min_ps( _mm256_set1_ps( 32767.f ), x ) );
+}
+
+//! Loads eight samples, scales them and adds dither values counter to counter + 7
+template <bool dither>
+static inline __m256 sample_convert_load8( const float *src, uint32_t counter )
+{
+	__m256 x = _mm256_mul_ps( _mm256_loadu_ps( src ), _mm256_set1_ps( SAMPLE_CONVERT_SCALE ) );
+	return dither ? _mm256_add_ps( x, sample_dither_tpdf8( counter ) ) : x;
+}
+#elif defined( __SSE2__ )
+//! Low 32 bits of products of four pairs of lanes (SSE2 only multiplies even lanes into 64 bits)
+static inline __m128i sample_convert_mullo4( __m128i a, __m128i b )
+{
+#if defined( __SSE4_1__ )
+	return _mm_mullo_epi32( a, b );
+#else
+	__m128i even = _mm_mul_epu32( a, b );
+	__m128i odd = _mm_mul_epu32( _mm_srli_epi64( a, 32 ), _mm_srli_epi64( b, 32 ) );
+	return _mm_unpacklo_epi32( _mm_shuffle_epi32( even, _MM_SHUFFLE( 0, 0, 2, 0 ) ), _mm_shuffle_epi32( odd, _MM_SHUFFLE( 0, 0, 2, 0 ) ) );
+#endif
+}
+
+//! sample_dither_tpdf( ) of n, n + 1, n + 2 and n + 3
+static inline __m128 sample_dither_tpdf4( uint32_t n )
+{
+	__m128i r = _mm_add_epi32( _mm_set1_epi32( n ), _mm_setr_epi32( 0, 1, 2, 3 ) );
+	r = sample_convert_mullo4( r, _mm_set1_epi32( 0x9e3779b1 ) );
+	r = _mm_xor_si128( r, _mm_srli_epi32( r, 15 ) );
+	r = sample_convert_mullo4( r, _mm_set1_epi32( 0x2c1b3c6d ) );
+	r = _mm_xor_si128( r, _mm_srli_epi32( r, 12 ) );
+	__m128i t = _mm_add_epi32( _mm_and_si128( r, _mm_set1_epi32( 0xffff ) ), _mm_srli_epi32( r, 16 ) );
+	t = _mm_sub_epi32( t, _mm_set1_epi32( 0xffff ) );
+	return _mm_mul_ps( _mm_cvtepi32_ps( t ), _mm_set1_ps( 1.f / 65536.f ) );
+}
+
+/**
+	Converts four scaled samples to 32-bit integers rounded to nearest. PACKSSDW does
+	the saturation - only values too large for CVTPS2DQ (which returns INT32_MIN for
+	them) are clamped first. With x as the second operand, NaN stays NaN and ends up
+	as -32768, just like in sample_convert_scaled( ).
+*/
+static inline __m128i sample_convert_scaled4( __m128 x )
+{
+	return _mm_cvtps_epi32( _mm_min_ps( _mm_set1_ps( 32767.f ), x ) );
+}
+
+//! Loads four samples, scales them and adds dither values counter to counter + 3
+template <bool dither>
+static inline __m128 sample_convert_load4( const float *src, uint32_t counter )
+{
+	__m128 x = _mm_mul_ps( _mm_loadu_ps( src ), _mm_set1_ps( SAMPLE_CONVERT_SCALE ) );
+	return dither ? _mm_add_ps( x, sample_dither_tpdf4( counter ) ) : x;
+}
+#endif
+
+#if defined( __ARM_ARCH_7EM__ ) && defined( __ARM_FP )
+//! Converts four scaled samples - all VCVTRs are issued before the first result is needed
+static inline void sample_convert_scaled4( const float *x, int32_t *s )
+{
+	float f[4];
+	for ( int k = 0; k < 4; k++ )
+		asm( "vcvtr.s32.f32 %0, %1" : "=t"( f[k] ) : "t"( x[k] ) );
+	for ( int k = 0; k < 4; k++ )
+	{
+		int32_t i;
+		std::memcpy( &i, &f[k], sizeof i );
+		asm( "ssat %0, #16, %1" : "=r"( s[k] ) : "r"( i ) );
+	}
+}
+#endif
+
+/**
+	Converts mono float samples to stereo frames (the same sample in both channels)
+*/
+template <bool dither>
+static inline void sample_convert_mono_impl( const float *__restrict src, uint32_t *__restrict dest, int frames, uint32_t counter )
+{
+	int i = 0;
+#if defined( __AVX512BW__ )
+	// Packing works within 128-bit quarters, so the low halfwords hold frames 0-15 in order
+	for ( ; i + 32 <= frames; i += 32 )
+	{
+		__m512i a = sample_convert_scaled16( sample_convert_load16<dither>( src + i, counter + i ) );
+		__m512i b = sample_convert_scaled16( sample_convert_load16<dither>( src + i + 16, counter + i + 16 ) );
+		__m512i s = _mm512_packs_epi32( a, b );
+		_mm512_storeu_si512( dest + i, _mm512_unpacklo_epi16( s, s ) );
+		_mm512_storeu_si512( dest + i + 16, _mm512_unpackhi_epi16( s, s ) );
+	}
+#elif defined( __AVX2__ )
+	// Packing works within 128-bit halves, so the low halfwords hold frames 0-7 in order
+	for ( ; i + 16 <= frames; i += 16 )
+	{
+		__m256i a = sample_convert_scaled8( sample_convert_load8<dither>( src + i, counter + i ) );
+		__m256i b = sample_convert_scaled8( sample_convert_load8<dither>( src + i + 8, counter + i + 8 ) );
+		__m256i s = _mm256_packs_epi32( a, b );
+		_mm256_storeu_si256( reinterpret_cast<__m256i*>( dest + i ), _mm256_unpacklo_epi16( s, s ) );
+		_mm256_storeu_si256( reinterpret_cast<__m256i*>( dest + i + 8 ), _mm256_unpackhi_epi16( s, s ) );
+	}
+#elif defined( __SSE2__ )
+	// Eight samples packed into halfwords, each one duplicated into a frame
+	for ( ; i + 8 <= frames; i += 8 )
+	{
+		__m128i a = sample_convert_scaled4( sample_convert_load4<dither>( src + i, counter + i ) );
+		__m128i b = sample_convert_scaled4( sample_convert_load4<dither>( src + i + 4, counter + i + 4 ) );
+		__m128i s = _mm_packs_epi32( a, b );
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( dest + i ), _mm_unpacklo_epi16( s, s ) );
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( dest + i + 4 ), _mm_unpackhi_epi16( s, s ) );
+	}
+#elif defined( __ARM_ARCH_7EM__ ) && defined( __ARM_FP )
+	for ( ; i + 4 <= frames; i += 4 )
+	{
+		float x[4];
+		int32_t s[4];
+		for ( int k = 0; k < 4; k++ )
+			x[k] = src[i + k] * SAMPLE_CONVERT_SCALE + ( dither ? sample_dither_tpdf( counter + i + k ) : 0.f );
+		sample_convert_scaled4( x, s );
+		for ( int k = 0; k < 4; k++ )
+			dest[i + k] = sample_convert_pack( s[k], s[k] );
+	}
+#endif
+
+	// Remaining frames
+	for ( ; i < frames; i++ )
+	{
+		float x = src[i] * SAMPLE_CONVERT_SCALE;
+		if ( dither ) x += sample_dither_tpdf( counter + i );
+		int32_t s = sample_convert_scaled( x );
+		dest[i] = sample_convert_pack( s, s );
+	}
+}
+
+/**
+	Converts interleaved stereo float samples (2 * frames values) to stereo frames
+*/
+template <bool dither>
+static inline void sample_convert_stereo_impl( const float *__restrict src, uint32_t *__restrict dest, int frames, uint32_t counter )
+{
+	int i = 0;
+#if defined( __AVX512BW__ )
+	// Packing works within 128-bit quarters - pairs of frames come out as 0, 4, 1, 5, 2, 6, 3, 7
+	for ( ; i + 16 <= frames; i += 16 )
+	{
+		__m512i a = sample_convert_scaled16( sample_convert_load16<dither>( src + 2 * i, counter + 2 * i ) );
+		__m512i b = sample_convert_scaled16( sample_convert_load16<dither>( src + 2 * i + 16, counter + 2 * i + 16 ) );
+		__m512i order = _mm512_setr_epi64( 0, 2, 4, 6, 1, 3, 5, 7 );
+		_mm512_storeu_si512( dest + i, _mm512_permutexvar_epi64( order, _mm512_packs_epi32( a, b ) ) );
+	}
+#elif defined( __AVX2__ )
+	// Packing works within 128-bit halves - frames come out as 0, 1, 4, 5, 2, 3, 6, 7
+	for ( ; i + 8 <= frames; i += 8 )
+	{
+		__m256i a = sample_convert_scaled8( sample_convert_load8<dither>( src + 2 * i, counter + 2 * i ) );
+		__m256i b = sample_convert_scaled8( sample_convert_load8<dither>( src + 2 * i + 8, counter + 2 * i + 8 ) );
+		__m256i f = _mm256_permute4x64_epi64( _mm256_packs_epi32( a, b ), _MM_SHUFFLE( 3, 1, 2, 0 ) );
+		_mm256_storeu_si256( reinterpret_cast<__m256i*>( dest + i ), f );
+	}
+#elif defined( __SSE2__ )
+	// Interleaved samples packed into halfwords are already frames
+	for ( ; i + 4 <= frames; i += 4 )
+	{
+		__m128i a = sample_convert_scaled4( sample_convert_load4<dither>( src + 2 * i, counter + 2 * i ) );
+		__m128i b = sample_convert_scaled4( sample_convert_load4<dither>( src + 2 * i + 4, counter + 2 * i + 4 ) );
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( dest + i ), _mm_packs_epi32( a, b ) );
+	}
+#elif defined( __ARM_ARCH_7EM__ ) && defined( __ARM_FP )
+	for ( ; i + 2 <= frames; i += 2 )
+	{
+		float x[4];
+		int32_t s[4];
+		for ( int k = 0; k < 4; k++ )
+			x[k] = src[2 * i + k] * SAMPLE_CONVERT_SCALE + ( dither ? sample_dither_tpdf( counter + 2 * i + k ) : 0.f );
+		sample_convert_scaled4( x, s );
+		dest[i] = sample_convert_pack( s[0], s[1] );
+		dest[i + 1] = sample_convert_pack( s[2], s[3] );
+	}
+#endif
+
+	// Remaining frames
+	for ( ; i < frames; i++ )
+	{
+		float l = src[2 * i] * SAMPLE_CONVERT_SCALE;
+		float r = src[2 * i + 1] * SAMPLE_CONVERT_SCALE;
+		if ( dither )
+		{
+			l += sample_dither_tpdf( counter + 2 * i );
+			r += sample_dither_tpdf( counter + 2 * i + 1 );
+		}
+		dest[i] = sample_convert_pack( sample_convert_scaled( l ), sample_convert_scaled( r ) );
+	}
+}
+
+/**
+	Converts frames mono samples to stereo frames. Dither is added if d is not null.
+*/
+static inline void sample_convert_mono( const float *__restrict src, uint32_t *__restrict dest, int frames, sample_dither *d = nullptr )
+{
+	if ( d )
+	{
+		sample_convert_mono_impl<true>( src, dest, frames, d->counter );
+		d->counter += frames;
+	}
+	else
+		sample_convert_mono_impl<false>( src, dest, frames, 0 );
+}
+
+/**
+	Converts frames interleaved stereo samples to stereo frames. Dither is added if d is not null.
+*/
+static inline void sample_convert_stereo( const float *__restrict src, uint32_t *__restrict dest, int frames, sample_dither *d = nullptr )
+{
+	if ( d )
+	{
+		sample_convert_stereo_impl<true>( src, dest, frames, d->counter );
+		d->counter += 2 * frames;
+	}
+	else
+		sample_convert_stereo_impl<false>( src, dest, frames, 0 );
+}
+
+/**
+	Converts a float sample (already scaled by 2^(bits - 1)) to a signed integer
+	with given number of bits. Rounds to nearest and saturates. The host version
+	works in double precision, so 32-bit results match VCVTR saturation exactly.
+*/
+template <int bits>
+static inline int32_t sample_convert_scaled_wide( float x )
+{
+#if defined( __ARM_ARCH_7EM__ ) && defined( __ARM_FP )
+	float f;
+	int32_t i;
+	asm( "vcvtr.s32.f32 %0, %1" : "=t"( f ) : "t"( x ) );
+	std::memcpy( &i, &f, sizeof i );
+	if ( bits < 32 ) asm( "ssat %0, %1, %2" : "=r"( i ) : "I"( bits ), "r"( i ) );
+	return i;
+#else
+	const double max = double( ( 1ull << ( bits - 1 ) ) - 1 );
+	return std::lrint( std::fmin( std::fmax( double( x ), -max - 1 ), max ) );
+#endif
+}
+
+/**
+	Returns a word holding a 24-bit or 32-bit sample in the order expected by the I2S
+	DMA - left-aligned in 32 bits, upper halfword at the lower address
+*/
+template <int bits>
+static inline uint32_t sample_convert_wide_word( int32_t v )
+{
+	uint32_t u = uint32_t( v ) << ( 32 - bits );
+	return ( u >> 16 ) | ( u << 16 );
+}
+
+/**
+	Converts mono or interleaved stereo float samples to 24-bit or 32-bit frames (two words each)
+*/
+template <int bits, bool stereo, bool dither>
+static inline void sample_convert_wide_impl( const float *__restrict src, uint32_t *__restrict dest, int frames, uint32_t counter )
+{
+	const float scale = float( 1ull << ( bits - 1 ) );
+
+	#pragma GCC unroll 4
+	for ( int i = 0; i < frames; i++ )
+	{
+		float l = src[stereo ? 2 * i : i] * scale;
+		float r = src[stereo ? 2 * i + 1 : i] * scale;
+		if ( dither )
+		{
+			l += sample_dither_tpdf( counter + 2 * i );
+			r = stereo ? r + sample_dither_tpdf( counter + 2 * i + 1 ) : l;
+		}
+		dest[2 * i] = sample_convert_wide_word<bits>( sample_convert_scaled_wide<bits>( l ) );
+		dest[2 * i + 1] = sample_convert_wide_word<bits>( sample_convert_scaled_wide<bits>( r ) );
+	}
+}
+
+//! Selects sample_convert_wide_impl( ) variant. Unsupported word lengths produce silence.
+template <bool stereo>
+static inline void sample_convert_wide( const float *__restrict src, uint32_t *__restrict dest, int frames, int bits, sample_dither *d )
+{
+	uint32_t counter = d ? d->counter : 0;
+	if ( d ) d->counter += 2 * frames;
+
+	if ( bits == 24 && d ) sample_convert_wide_impl<24, stereo, true>( src, dest, frames, counter );
+	else if ( bits == 24 ) sample_convert_wide_impl<24, stereo, false>( src, dest, frames, counter );
+	else if ( bits == 32 && d ) sample_convert_wide_impl<32, stereo, true>( src, dest, frames, counter );
+	else if ( bits == 32 ) sample_convert_wide_impl<32, stereo, false>( src, dest, frames, counter );
+	else std::memset( dest, 0, 2 * frames * sizeof( uint32_t ) );
+}
+
+/**
+	Converts frames mono samples to 24-bit or 32-bit stereo frames (2 * frames words).
+	Dither is added if d is not null.
+*/
+static inline void sample_convert_mono_wide( const float *__restrict src, uint32_t *__restrict dest, int frames, int bits, sample_dither *d = nullptr )
+{
+	sample_convert_wide<false>( src, dest, frames, bits, d );
+}
+
+/**
+	Converts frames interleaved stereo samples to 24-bit or 32-bit stereo frames (2 * frames words).
+	Dither is added if d is not null.
+*/
+static inline void sample_convert_stereo_wide( const float *__restrict src, uint32_t *__restrict dest, int frames, int bits, sample_dither *d = nullptr )
+{
+	sample_convert_wide<true>( src, dest, frames, bits, d );
+}
+
+/**
+	Converts one received sample to float. 16-bit frames hold left sample in the low
+	halfword, longer samples take one word each with upper halfword first.
+*/
+template <bool wide>
+static inline float sample_convert_input_value( const uint32_t *src, int i, bool right )
+{
+	if ( wide )
+	{
+		uint32_t w = src[2 * i + right];
+		return float( int32_t( ( w << 16 ) | ( w >> 16 ) ) ) * ( 1.f / 2147483648.f );
+	}
+	else
+		return float( int16_t( right ? src[i] >> 16 : src[i] & 0xffff ) ) * ( 1.f / SAMPLE_CONVERT_SCALE );
+}
+
+/**
+	Converts received frames to left and right float samples or to a mono mix of both
+*/
+template <bool wide, bool mono>
+static inline void sample_convert_input_impl( const uint32_t *__restrict src, float *__restrict left, float *__restrict right, int frames )
+{
+	#pragma GCC unroll 4
+	for ( int i = 0; i < frames; i++ )
+	{
+		float l = sample_convert_input_value<wide>( src, i, false );
+		float r = sample_convert_input_value<wide>( src, i, true );
+		if ( mono )
+			left[i] = 0.5f * ( l + r );
+		else
+		{
+			left[i] = l;
+			right[i] = r;
+		}
+	}
+}
+
+/**
+	Converts frames received stereo frames with given sample length to separate left
+	and right channels. If right is null, left receives a mix of both channels.
+	24-bit samples are received left-aligned in 32 bits, so they're handled like 32-bit ones.
+*/
+static inline void sample_convert_input( const uint32_t *__restrict src, float *__restrict left, float *__restrict right, int frames, int bits )
+{
+	if ( bits == 16 && right ) sample_convert_input_impl<false, false>( src, left, right, frames );
+	else if ( bits == 16 ) sample_convert_input_impl<false, true>( src, left, right, frames );
+	else if ( right ) sample_convert_input_impl<true, false>( src, left, right, frames );
+	else sample_convert_input_impl<true, true>( src, left, right, frames );
+}
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef SPSC_RING_HPP
+#define SPSC_RING_HPP
+
+#include <atomic>
+#include <cinttypes>
+#include <cstddef>
+
+/**
+	\brief Lock-free single-producer single-consumer ring buffer
+
+	One context (e.g. main loop) may only push and the other one (e.g. an ISR) may
+	only pop. Neither side ever blocks or disables interrupts. Indices are free-running
+	32-bit counters, so the capacity has to be a power of two.
+*/
+template <typename T, size_t N>
+class spsc_ring
+{
+	static_assert( N > 0 && ( N & ( N - 1 ) ) == 0, "spsc_ring capacity must be a power of two" );
+
+public:
+	static constexpr size_t capacity = N;
+
+	//! Number of elements currently in the buffer
+	size_t size( ) const
+	{
+		return m_head.load( std::memory_order_acquire ) - m_tail.load( std::memory_order_acquire );
+	}
+
+	bool empty( ) const
+	{
+		return size( ) == 0;
+	}
+
+	//! Free space - only reliable in the producer context
+	size_t free( ) const
+	{
+		return N - size( );
+	}
+
+	//! Producer: adds one element. Returns false (and counts overflow) if the buffer is full.
+	bool push( const T &v )
+	{
+		uint32_t head = m_head.load( std::memory_order_relaxed );
+		if ( head - m_tail.load( std::memory_order_acquire ) >= N )
+		{
+			m_overflow_counter++;
+			return false;
+		}
+
+		m_data[head & ( N - 1 )] = v;
+		m_head.store( head + 1, std::memory_order_release );
+		return true;
+	}
+
+	//! Producer: adds all n elements or none of them (counts overflow in that case)
+	bool push_all( const T *data, size_t n )
+	{
+		uint32_t head = m_head.load( std::memory_order_relaxed );
+		if ( n > N - ( head - m_tail.load( std::memory_order_acquire ) ) )
+		{
+			m_overflow_counter++;
+			return false;
+		}
+
+		for ( size_t i = 0; i < n; i++ )
+			m_data[( head + i ) & ( N - 1 )] = data[i];
+		m_head.store( head + n, std::memory_order_release );
+		return true;
+	}
+
+	//! Consumer: removes one element. Returns false if the buffer is empty.
+	bool pop( T &v )
+	{
+		uint32_t tail = m_tail.load( std::memory_order_relaxed );
+		if ( tail == m_head.load( std::memory_order_acquire ) ) return false;
+
+		v = m_data[tail & ( N - 1 )];
+		m_tail.store( tail + 1, std::memory_order_release );
+		return true;
+	}
+
+	//! Consumer: reads the oldest element without removing it. Returns false if the buffer is empty.
+	bool peek( T &v ) const
+	{
+		uint32_t tail = m_tail.load( std::memory_order_relaxed );
+		if ( tail == m_head.load( std::memory_order_acquire ) ) return false;
+
+		v = m_data[tail & ( N - 1 )];
+		return true;
+	}
+
+	/**
+		Consumer: returns pointer to the oldest element and number of elements that
+		can be read from there without wrapping around (e.g. by DMA). The data stays
+		in the buffer until consume( ) is called.
+	*/
+	const T *peek_contiguous( size_t &n ) const
+	{
+		uint32_t tail = m_tail.load( std::memory_order_relaxed );
+		uint32_t count = m_head.load( std::memory_order_acquire ) - tail;
+		uint32_t offset = tail & ( N - 1 );
+		n = ( offset + count > N ) ? N - offset : count;
+		return &m_data[offset];
+	}
+
+	//! Consumer: discards n oldest elements
+	void consume( size_t n )
+	{
+		m_tail.store( m_tail.load( std::memory_order_relaxed ) + n, std::memory_order_release );
+	}
+
+	//! Number of rejected push operations
+	uint32_t get_overflow_count( ) const
+	{
+		return m_overflow_counter;
+	}
+
+private:
+	T m_data[N];
+	std::atomic<uint32_t> m_head{0}; //!< Written only by the producer
+	std::atomic<uint32_t> m_tail{0}; //!< Written only by the consumer
+	volatile uint32_t m_overflow_counter = 0; //!< Written only by the producer
+};
+
+#endif
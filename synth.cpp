@@ -15,6 +15,11 @@
 #include <analog.hpp>
 #include <midi.hpp>
 #include <fast_math.hpp>
+#include <profiler.hpp>
+#include <systime.hpp>
+#include <decimator.hpp>
+#include <control_map.hpp>
+#include <voice_bank.hpp>
 
 #include <cstring.hpp>
 
@@ -35,7 +40,9 @@
 #define DSP_CLASS_PREFIX faust_dsp_
 #define DSP_CLASS MACRO_JOIN( DSP_CLASS_PREFIX, DSP_CLASS_NAME )
 #define DSP_CLASS_HEADER <faust/DSP_CLASS_NAME.hpp>
+#define DSP_BINDINGS_HEADER <faust/MACRO_JOIN( DSP_CLASS_NAME, _bindings ).hpp>
 #include DSP_CLASS_HEADER
+#include DSP_BINDINGS_HEADER
 
 /**
 	floatbuf[0] = std::tan( floatbuf[0] ); // 182 cycles
@@ -46,87 +53,40 @@
 	\todo fix led code in fault handlers
 */
 
-/**
-	Converts a string describing analog input to index in mux_inputs array.
-	The input string must be at least 2 characters long, where the first
-	character is one of the letters 'abcd'. Following characters must form
-	a number between 2 and 10.
-*/
-static int analog_input_string_to_mux_index( const cstring &s )
-{
-	if ( s.size( ) < 2 )
-		throw std::runtime_error( "Invalid analog input name (length < 2)" );
-	
-	// Determine connector number
-	int conn = std::tolower( s[0] ) - 'a';
-	if ( conn < 0 || conn > 3 )
-		throw std::runtime_error( "Invalid analog input name (bad connector letter)" );
-	
-	// Determine pin number
-	int pin = std::atoi( s.substr( 1 ) );
-	if ( pin < 1 || pin > 10 )
-		throw std::runtime_error( "Invalid analog input name (bad pin number)" );
-	
-	// Pin number -> Multiplexer input
-	static const int hash[10] = 
-	{
-		0, 0, // VCC, GND
-		1, 6,
-		2, 4,
-		0, 7,
-		3, 5,
-	};
-	
-	return conn * 8 + hash[pin - 1];
-}
-
-std::vector<std::pair<faust_control, volatile float*>> dsp_controls_to_assignments_array( const std::unordered_map<float*, faust_control> &controls )
-{
-	std::vector<std::pair<faust_control, volatile float*>> assignments;
-	
-	for ( const auto &[ptr, ctl] : controls )
-	{
-		// Print the metadata
-		if ( ctl.metadata.size( ) )
-		{
-			comprintf( "Metadata of control parameter %s:\n", ctl.name.c_str( ) );
-			for ( const auto &[k,v] : ctl.metadata )
-				comprintf( "\t - %s = %s\n", k.c_str( ), v.c_str( ) );
-		}
-
-		// Find 'analog' metadata entry
-		auto it = ctl.metadata.find( "analog" );
-		if ( it == ctl.metadata.end( ) ) continue;
-		
-		// Assign DSP control to analog input
-		int id = analog_input_string_to_mux_index( it->second );
-		assignments.emplace_back( ctl, &mux_inputs[id] );
-		
-		// FIXME
-		comprintf( "DSP parameter '%s' is controlled from input %d\n", ctl.name.c_str( ), id );
-	}
-	
-	return assignments;
-}
+// Per-block execution time statistics
+static profiler_probe dsp_compute_probe( "dsp.compute" );
+static profiler_probe control_update_probe( "control_update" );
+static profiler_probe midi_parse_probe( "midi_parse" );
+static profiler_probe decimator_probe( "decimator" );
 
 void synth_main( )
 {
-	// The audio buffer
-	size_t buffer_size = audio_get_mono_batch_size( );
-	float buffer[buffer_size];
+	// The audio buffers - large enough for the largest block size (static ones don't fit on the stack)
+	float buffer[AUDIO_BATCH_SIZE / 2];
+	static float input_buffer[2][AUDIO_BATCH_SIZE / 2];
+	static float oversampled_buffer[AUDIO_BATCH_SIZE / 2 * decimator::max_factor];
 
 	// The DSP
-	faust_dsp dsp( new DSP_CLASS, 48000 );
+	faust_dsp dsp( new DSP_CLASS, audio_get_sample_rate( ) );
 	
-	comprintf( "DSP size: %d\n", sizeof( DSP_CLASS ) );
+	// DSP inputs are fed from the codec's ADC - one input gets a mix of both channels
+	int input_count = dsp.get_input_count( );
+	if ( input_count > 2 )
+		throw std::runtime_error( "DSP has more than 2 inputs" );
+	if ( dsp.get_output_count( ) != 1 )
+		throw std::runtime_error( "DSP must have exactly 1 output" );
+	float *input_ptr[2] = {input_buffer[0], input_buffer[1]};
+	
+	comprintf( "DSP size: %d\n", static_cast<int>( sizeof( DSP_CLASS ) ) );
 	
 	// Print DSP info
 	comprintf( "\n\n" );
 	for ( auto [k,v] : dsp.get_metadata( ) )
 		comprintf( "%s: %s\n", k.c_str( ), v.c_str( ) );
-	comprintf( "dsp controls: %d\n", dsp.get_controls( ).size( ) );
-	for ( auto [k,v] : dsp.get_controls( ) )
-		comprintf( " - %s\n", v.name.c_str( ) );
+	comprintf( "dsp inputs: %d\n", input_count );
+	comprintf( "dsp controls: %d\n", static_cast<int>( dsp_control_info.size( ) ) );
+	for ( const auto &ctl : dsp_control_info )
+		comprintf( " - %s\n", ctl.name );
 	
 	// Retreive polyphony information from the dsp
 	int polyphony = 1;
@@ -136,76 +96,356 @@ void synth_main( )
 		if ( n ) polyphony = n;
 	}
 	catch ( const std::out_of_range &ex ) {}
+	if ( polyphony < 1 || polyphony > MIDI_MAX_POLYPHONY )
+	{
+		comprintf( "error: polyphony %d is not supported (1-%d), using %d\n", polyphony, MIDI_MAX_POLYPHONY, polyphony < 1 ? 1 : MIDI_MAX_POLYPHONY );
+		polyphony = polyphony < 1 ? 1 : MIDI_MAX_POLYPHONY;
+	}
+
+	// Sample rate - the codec is reprogrammed and the DSP is initialized again if it's different
+	try
+	{
+		audio_set_sample_rate( std::atoi( dsp.get_metadata( ).at( "sample_rate" ).c_str( ) ) );
+	}
+	catch ( const std::out_of_range &ex ) {}
+	int sample_rate = audio_get_sample_rate( );
+	
+	// Oversampling - the DSP runs at a multiple of the sample rate and its output is decimated
+	decimator output_decimator;
+	try
+	{
+		output_decimator.set_factor( std::atoi( dsp.get_metadata( ).at( "oversampling" ).c_str( ) ) );
+	}
+	catch ( const std::out_of_range &ex ) {}
+	int oversampling = output_decimator.get_factor( );
+	if ( oversampling > 1 && input_count )
+		throw std::runtime_error( "oversampling is not supported for DSPs with inputs" );
+	
+	if ( dsp.get_sample_rate( ) != sample_rate * oversampling )
+		dsp.set_sample_rate( sample_rate * oversampling );
+	comprintf( "sample rate: %d\n", sample_rate );
+	if ( oversampling > 1 )
+		comprintf( "oversampling: %dx (DSP at %d Hz, decimator delay %.2f samples)\n", oversampling, dsp.get_sample_rate( ), output_decimator.get_delay( ) );
+
+	// Audio block size - number of frames or "auto" (see SYNTH_BLOCK_SIZE)
+	int block_size = SYNTH_BLOCK_SIZE;
+	try
+	{
+		const cstring &s = dsp.get_metadata( ).at( "block_size" );
+		block_size = ( s == "auto" ) ? 0 : std::atoi( s.c_str( ) );
+	}
+	catch ( const std::out_of_range &ex ) {}
+	bool auto_block_size = ( block_size == 0 );
+	audio_set_mono_batch_size( auto_block_size ? AUDIO_BATCH_SIZE / 2 : block_size );
+	int buffer_size = audio_get_mono_batch_size( );
+	comprintf( "block size: %d%s\n", buffer_size, auto_block_size ? " (auto)" : "" );
+
+	// Number of output periods - more periods absorb longer DSP time spikes, but add latency
+	try
+	{
+		audio_set_queue_depth( std::atoi( dsp.get_metadata( ).at( "queue_depth" ).c_str( ) ) );
+	}
+	catch ( const std::out_of_range &ex ) {}
+	comprintf( "audio queue depth: %d\n", audio_get_queue_depth( ) );
+	if ( input_count )
+		comprintf( "audio input latency: %d frames\n", audio_get_queue_depth( ) * buffer_size );
+
+	// Output sample length - 16, 24 or 32 bits
+	try
+	{
+		audio_set_word_length( std::atoi( dsp.get_metadata( ).at( "word_length" ).c_str( ) ) );
+	}
+	catch ( const std::out_of_range &ex ) {}
+	comprintf( "audio word length: %d\n", audio_get_word_length( ) );
+
+	// TPDF dither (1 LSB of the output word length)
+	try
+	{
+		audio_set_dither( std::atoi( dsp.get_metadata( ).at( "dither" ).c_str( ) ) );
+	}
+	catch ( const std::out_of_range &ex ) {}
 
 	// Midi interpreter
 	polyphonic_midi_controller poly_controller( polyphony );
 	midi_interpreter midi( &poly_controller, 0 );
 	
-	// Get control assignments
-	std::vector<std::pair<faust_control, volatile float*>> control_assignments = dsp_controls_to_assignments_array( dsp.get_controls( ) );
+	// A single voice DSP is instanced for every voice, otherwise the DSP contains all of them.
+	// Controls which aren't bound to voices are shared - they're set on voice 0 and copied to others.
+	int control_count = dsp_control_info.size( );
+	bool shared_controls[control_count + 1];
+	for ( int i = 0; i < control_count; i++ )
+	{
+		const faust_control_info &ctl = dsp_control_info[i];
+		shared_controls[i] = ( ctl.binding == BINDING_NONE || ctl.binding == BINDING_ANALOG ) && ctl.type != CONTROL_BARGRAPH;
+	}
+	voice_bank voices( dsp, dsp_voice_instancing ? polyphony : 1, shared_controls, control_count, AUDIO_BATCH_SIZE / 2 * oversampling );
+	bool voice_active[polyphony];
+	for ( int i = 0; i < polyphony; i++ )
+		voice_active[i] = true;
+	if ( dsp_voice_instancing )
+		comprintf( "voice DSP instanced %d times\n", polyphony );
 
+	// Silent voices sleep after being quiet for sleep_hold milliseconds (negative value disables
+	// sleeping). A DSP with all voices in it restarts from a cleared state (e.g. oscillator phases)
+	// when it wakes up, so it only sleeps if it declares sleep_hold and has gates to wake it up.
+	int sleep_hold = SYNTH_SLEEP_HOLD;
+	bool dsp_sleep = dsp_voice_instancing;
+	try
+	{
+		sleep_hold = std::atoi( dsp.get_metadata( ).at( "sleep_hold" ).c_str( ) );
+		for ( const auto &ctl : dsp_control_info )
+			dsp_sleep |= ctl.binding == BINDING_GATE;
+	}
+	catch ( const std::out_of_range &ex ) {}
+	if ( dsp_sleep && sleep_hold >= 0 )
+	{
+		voices.set_sleep( voice_allocator<MIDI_MAX_POLYPHONY>::silence_level, sleep_hold * dsp.get_sample_rate( ) / 1000 );
+		comprintf( "sleep hold: %d ms\n", sleep_hold );
+	}
+	else
+		voices.set_sleep( 0, 0 );
+	
+	// Controls driven by analog inputs - what drives them comes from the table generated at build time
+	static control_map<dsp_analog_binding_count> analog_controls;
+	for ( int i = 0; i < control_count; i++ )
+	{
+		const faust_control_info &ctl = dsp_control_info[i];
+		if ( ctl.binding != BINDING_ANALOG ) continue;
+		analog_controls.add( voices.get_zone( 0, i ), ctl.source, ctl.curve, ctl.min, ctl.max, ctl.step, ctl.smooth );
+		comprintf( "DSP parameter '%s' is controlled from input %d\n", ctl.name, ctl.source );
+	}
+
+	// From now on, printing must not stall the audio loop
+	com_set_blocking( false );
+	
 	// Start the audio engine
+	profiler_init( );
 	audio_start( );
 	
 	float dummy_float;
 	float *midi_note_ctl_ptr[polyphony];
 	float *midi_gain_ctl_ptr[polyphony];
 	float *midi_gate_ctl_ptr[polyphony];
+	const float *voice_level_ptr[polyphony];
+	float voice_levels[polyphony];
+	bool has_voice_levels = dsp_voice_instancing;
+	float no_level = 1.f; // Voices without a level are never considered silent
 
 	// Get polyphonic DSP interface
 	for ( int i = 0; i < polyphony; i++ )
 	{
-		char name[64];
-		const faust_control *ctl_ptr;
-		
 		midi_note_ctl_ptr[i] = &dummy_float;
 		midi_gain_ctl_ptr[i] = &dummy_float;
 		midi_gate_ctl_ptr[i] = &dummy_float;
 
-		std::snprintf( name, 64, "note_%d", i );
-		ctl_ptr = dsp.get_control_by_name( name );
-		if ( ctl_ptr ) midi_note_ctl_ptr[i] = ctl_ptr->ptr;
+		// Instanced voices without a level bargraph are silent when their output is
+		voice_level_ptr[i] = dsp_voice_instancing ? &voices.get_peak( i ) : &no_level;
+	}
+	for ( int v = 0; v < voices.size( ); v++ )
+	{
+		for ( int i = 0; i < control_count; i++ )
+		{
+			// In an instanced DSP, voice v's controls are in instance v
+			const faust_control_info &ctl = dsp_control_info[i];
+			int voice = dsp_voice_instancing ? v : ctl.source;
+			if ( voice >= polyphony ) continue; // Above the supported polyphony
+			if ( ctl.binding == BINDING_NOTE ) midi_note_ctl_ptr[voice] = voices.get_zone( v, i );
+			if ( ctl.binding == BINDING_GAIN ) midi_gain_ctl_ptr[voice] = voices.get_zone( v, i );
+			if ( ctl.binding == BINDING_GATE ) midi_gate_ctl_ptr[voice] = voices.get_zone( v, i );
+			if ( ctl.binding == BINDING_LEVEL ) voice_level_ptr[voice] = voices.get_zone( v, i );
+			has_voice_levels |= ctl.binding == BINDING_LEVEL;
+		}
+	}
 
-		std::snprintf( name, 64, "gain_%d", i );
-		ctl_ptr = dsp.get_control_by_name( name );
-		if ( ctl_ptr ) midi_gain_ctl_ptr[i] = ctl_ptr->ptr;
+	// Automatic block size - the longest block processing time in a window and the pending new size
+	uint32_t auto_block_worst = 0;
+	int auto_block_frames = 0, auto_block_resize = 0;
 
-		std::snprintf( name, 64, "gate_%d", i );
-		ctl_ptr = dsp.get_control_by_name( name );
-		if ( ctl_ptr ) midi_gate_ctl_ptr[i] = ctl_ptr->ptr;
-	}
+	// Profiler statistics are reported every PROFILER_REPORT_INTERVAL seconds (if it's not 0)
+	// and whenever MIDI_REPORT_CC is received
+	int profiler_frames = 0;
+	
+	// Voice sleep statistics - in voice-samples, so sub-blocks of any length add up
+	uint64_t computed_voice_samples = 0, sleeping_voice_samples = 0, total_dsp_ticks = 0;
 
 	while ( 1 )
-	{		
-		DWT->CTRL |= 1;
-		DWT->CYCCNT = 0;
+	{
+		// MIDI events are rendered exactly one queue length after they were received - each
+		// event keeps its position within the block, so the latency is constant and there's no
+		// jitter, no matter how far ahead of the DMA the loop currently is
+		uint32_t block_ticks = uint64_t( systime_ticks_per_second( ) ) * buffer_size / sample_rate;
+		uint32_t block_start = audio_get_next_period_time( ) - audio_get_queue_depth( ) * block_ticks;
+		uint32_t block_end = block_start + block_ticks;
+		uint32_t dsp_ticks = 0, midi_ticks = 0, control_ticks = 0;
+		uint32_t t0 = profiler_timestamp( );
 		
-		dsp.compute( buffer_size, {}, {buffer} );
+		// Read analog inputs (smoothing runs at the DSP's rate)
+		analog_controls.update( mux_inputs, buffer_size * oversampling );
 		
-		// auto t1 = DWT->CYCCNT;
+		uint32_t t1 = profiler_timestamp( );
 		
-		// Pass note, gain and gate data to the DSP
-		for ( int i = 0; i < polyphony; i++ )
-		{
-			*midi_note_ctl_ptr[i] = poly_controller.get_voice_note( i );
-			*midi_gain_ctl_ptr[i] = poly_controller.get_voice_gain( i );
-			*midi_gate_ctl_ptr[i] = poly_controller.get_voice_gate( i );
-		}
+		// Input captured one queue length before this block plays (just like MIDI)
+		if ( input_count )
+			audio_receive( input_ptr, input_count );
 		
-		// Update controls from analog inputs
-		for ( const auto &[ctl, src] : control_assignments )
-			*ctl.ptr = ctl.min + ( ctl.max - ctl.min ) * *src;
+		// With oversampling, the DSP computes more samples per block into a separate buffer
+		int render_size = buffer_size * oversampling;
+		float *render_buffer = oversampling > 1 ? oversampled_buffer : buffer;
 		
-		// Interpret received MIDI data
-		for ( int i = 0; i < midi_data_size; i++ )
-			midi.push( midi_data[i] );
-		midi_data_size = 0;
+		// Compute the block in parts split at MIDI events and, while smoothed controls are
+		// moving, every SYNTH_MIN_SUBBLOCK frames
+		for ( int pos = 0, end; pos < render_size; pos = end )
+		{
+			uint32_t t2 = profiler_timestamp( );
+			end = render_size;
+			
+			// Interpret MIDI data received before the event at the next sub-block boundary
+			midi_rx_byte rx;
+			while ( midi_rx_ring.peek( rx ) )
+			{
+				// Received after the block boundary - belongs to the next block
+				if ( int32_t( rx.timestamp - block_end ) >= 0 ) break;
+				
+				int offset = 0;
+				int32_t dt = rx.timestamp - block_start;
+				if ( dt > 0 )
+					offset = uint64_t( dt ) * buffer_size / block_ticks / SYNTH_MIN_SUBBLOCK * SYNTH_MIN_SUBBLOCK * oversampling;
+				
+				if ( offset > pos )
+				{
+					end = offset;
+					break;
+				}
+				
+				midi.push( rx.byte );
+				midi_rx_ring.pop( rx );
+			}
+			
+			if ( analog_controls.ramping( ) && end - pos > SYNTH_MIN_SUBBLOCK * oversampling )
+				end = pos + SYNTH_MIN_SUBBLOCK * oversampling;
+			
+			uint32_t t3 = profiler_timestamp( );
+			
+			analog_controls.apply( pos, end );
+			
+			// Pass note, gain and gate data to the DSP. Instanced voices which are neither
+			// playing nor sounding can sleep. A DSP with all voices in it can only sleep
+			// (if allowed) when no key is held and it doesn't process any input.
+			bool any_gate = input_count > 0 || !dsp_sleep;
+			for ( int i = 0; i < polyphony; i++ )
+			{
+				*midi_note_ctl_ptr[i] = poly_controller.get_voice_note( i );
+				*midi_gain_ctl_ptr[i] = poly_controller.get_voice_gain( i );
+				*midi_gate_ctl_ptr[i] = poly_controller.get_voice_gate( i );
+				if ( dsp_voice_instancing )
+					voice_active[i] = poly_controller.is_voice_active( i );
+				any_gate |= poly_controller.get_voice_gate( i ) > 0;
+			}
+			if ( !dsp_voice_instancing )
+				voice_active[0] = any_gate;
+			
+			uint32_t t4 = profiler_timestamp( );
+			
+			float *inputs[2] = {input_buffer[0] + pos, input_buffer[1] + pos};
+			int computed = voices.compute( end - pos, inputs, render_buffer + pos, voice_active );
+			
+			uint32_t t5 = profiler_timestamp( );
+			computed_voice_samples += computed * ( end - pos );
+			sleeping_voice_samples += ( voices.size( ) - computed ) * ( end - pos );
+			
+			// Levels at the end of the sub-block decide which voices the next events get
+			if ( has_voice_levels )
+			{
+				for ( int i = 0; i < polyphony; i++ )
+					voice_levels[i] = *voice_level_ptr[i];
+				poly_controller.set_voice_levels( voice_levels );
+			}
+			
+			// Writing voice controls and passing levels back count as control updates
+			midi_ticks += t3 - t2;
+			control_ticks += t4 - t3 + profiler_timestamp( ) - t5;
+			dsp_ticks += t5 - t4;
+		}
 		
-		// comprintf( "%ld\n", t1 );
+		dsp_compute_probe.record( dsp_ticks );
+		total_dsp_ticks += dsp_ticks;
+		control_update_probe.record( t1 - t0 + control_ticks );
+		midi_parse_probe.record( midi_ticks );
 		
+		if ( oversampling > 1 )
+		{
+			profiler_scope scope( decimator_probe );
+			output_decimator.process( oversampled_buffer, buffer, buffer_size );
+		}
+
+		profiler_frames += buffer_size;
+		if ( ( PROFILER_REPORT_INTERVAL && profiler_frames >= PROFILER_REPORT_INTERVAL * sample_rate ) || poly_controller.take_report_request( ) )
+		{
+			profiler_report( buffer_size, sample_rate );
+			profiler_reset( );
+			
+			// Ticks saved are estimated from the average cost of a computed voice
+			int blocks = profiler_frames / buffer_size;
+			float voice_ticks = computed_voice_samples ? float( total_dsp_ticks ) / computed_voice_samples : 0.f;
+			comprintf( "voices asleep: %.2f of %d on average, ~%d ticks/block saved\n",
+				float( sleeping_voice_samples ) / ( profiler_frames * oversampling ), voices.size( ),
+				int( voice_ticks * sleeping_voice_samples / blocks ) );
+			computed_voice_samples = sleeping_voice_samples = total_dsp_ticks = 0;
+			if ( com_drop_counter )
+				comprintf( "%d console messages dropped\n", com_drop_counter );
+			if ( midi_rx_ring.get_overflow_count( ) )
+				comprintf( "%d MIDI bytes lost\n", int( midi_rx_ring.get_overflow_count( ) ) );
+			int queue_min, queue_max;
+			audio_get_queue_stats( queue_min, queue_max );
+			comprintf( "audio queue: %d-%d of %d periods ready\n", queue_min, queue_max, audio_get_queue_depth( ) );
+			if ( input_count )
+			{
+				int latency_min, latency_max;
+				audio_get_input_latency( latency_min, latency_max );
+				comprintf( "audio input latency: %d-%d frames, %d overruns\n", latency_min, latency_max, audio_input_overrun_counter );
+			}
+			profiler_frames = 0;
+		}
 
+		// Time spent on the block, not counting the wait for a free period in audio_dispatch_mono( )
+		uint32_t block_time = profiler_timestamp( ) - t0;
 		audio_dispatch_mono( buffer );
 
+		// In automatic mode, the longest block processing time is kept below SYNTH_AUTO_BLOCK_LOAD
+		// of the block's duration - the block is doubled if it's exceeded and halved if the load
+		// would stay below it even if the time didn't shrink with the block (spikes usually don't).
+		// Underruns mean that the block is too short for the DSP anyway.
+		if ( auto_block_size )
+		{
+			auto_block_worst = std::max( auto_block_worst, block_time );
+			auto_block_frames += buffer_size;
+			if ( auto_block_frames >= SYNTH_AUTO_BLOCK_WINDOW * sample_rate / 1000 || audio_underrun_counter )
+			{
+				float load = auto_block_worst / ( float( profiler_ticks_per_second( ) ) * buffer_size / sample_rate );
+				auto_block_resize = 0;
+				if ( ( load > SYNTH_AUTO_BLOCK_LOAD || audio_underrun_counter ) && buffer_size < AUDIO_BATCH_SIZE / 2 )
+					auto_block_resize = buffer_size * 2;
+				else if ( 2 * load < SYNTH_AUTO_BLOCK_LOAD && buffer_size > AUDIO_MIN_BATCH_SIZE / 2 )
+					auto_block_resize = buffer_size / 2;
+				auto_block_worst = 0;
+				auto_block_frames = 0;
+			}
+			
+			// Restarting the DMA leaves a gap in the output, so the block only shrinks while
+			// the output is silent. Underruns caused by the old block size are forgotten.
+			if ( auto_block_resize > buffer_size || ( auto_block_resize && voice_peak( buffer, buffer_size ) < voice_allocator<1>::silence_level ) )
+			{
+				audio_set_mono_batch_size( auto_block_resize );
+				buffer_size = audio_get_mono_batch_size( );
+				audio_underrun_counter = 0;
+				auto_block_resize = 0;
+				profiler_reset( );
+				profiler_frames = 0;
+				computed_voice_samples = sleeping_voice_samples = total_dsp_ticks = 0;
+				comprintf( "block size changed to %d\n", buffer_size );
+			}
+		}
+
 		// Light up both LEDs on underrun
 		if ( audio_underrun_counter )
 		{
@@ -234,12 +474,16 @@ void HAL_TIM_PeriodElapsedCallback( TIM_HandleTypeDef *h )
 	}
 }
 
+#ifndef SYNTH_HOST
 int main( )
 {
 	// HAL + clock init
 	HAL_Init( );
 	SystemClock_Config( );
 	
+	// Keep the debugger working while the CPU sleeps waiting for audio DMA
+	HAL_DBGMCU_EnableDBGSleepMode( );
+	
 	// Peripherals init
 	MX_GPIO_Init( );
 	MX_DMA_Init( );
@@ -254,7 +498,8 @@ int main( )
 	// Init audio codec, I2S and sound engine
 	audio_init( );
 	
-	// MIDI init
+	// MIDI init - received bytes are timestamped with the cycle counter
+	systime_init( );
 	midi_init( );
 	
 	// Init inputs
@@ -277,3 +522,4 @@ int main( )
 	while ( 1 );
 	return 0;
 }
+#endif
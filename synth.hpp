@@ -17,5 +17,49 @@ static UART_HandleTypeDef &ext_uart = huart1;
 // static UART_HandleTypeDef &midi_uart = huart3;
 static I2C_HandleTypeDef &i2c = hi2c1;
 
+/**
+	MIDI events are applied inside audio blocks at sample offsets rounded down to
+	a multiple of this value, which bounds the number of dsp.compute( ) calls per
+	block. Setting it to the block size applies all events at block boundaries.
+	Smoothed analog controls are also updated this often while they're moving.
+*/
+#ifndef SYNTH_MIN_SUBBLOCK
+#define SYNTH_MIN_SUBBLOCK 16
+#endif
+
+/**
+	Audio block size (in frames) used when the DSP doesn't declare "block_size"
+	metadata. 0 selects automatic mode - the largest block size is used at first
+	and it's adjusted according to measured processing time (see SYNTH_AUTO_BLOCK_LOAD).
+*/
+#ifndef SYNTH_BLOCK_SIZE
+#define SYNTH_BLOCK_SIZE 256
+#endif
+
+/**
+	In automatic block size mode, the longest time spent processing a block (in windows
+	of SYNTH_AUTO_BLOCK_WINDOW milliseconds) is kept below this fraction of the block's
+	duration. The block is doubled as soon as it's exceeded and halved while the output
+	is silent if it'd be met with half as long blocks.
+*/
+#ifndef SYNTH_AUTO_BLOCK_LOAD
+#define SYNTH_AUTO_BLOCK_LOAD 0.5f
+#endif
+
+#ifndef SYNTH_AUTO_BLOCK_WINDOW
+#define SYNTH_AUTO_BLOCK_WINDOW 500
+#endif
+
+/**
+	Time (in milliseconds) a silent voice keeps being computed before it sleeps, used
+	when the DSP doesn't declare "sleep_hold" metadata. Long enough not to cut off
+	quiet tails that still rise above the silence level now and then.
+*/
+#ifndef SYNTH_SLEEP_HOLD
+#define SYNTH_SLEEP_HOLD 50
+#endif
+
+extern void synth_main( );
+
 
 #endif
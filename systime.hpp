@@ -0,0 +1,38 @@
+#ifndef SYSTIME_HPP
+#define SYSTIME_HPP
+
+#include <cinttypes>
+#include <stm32f4xx.h>
+
+/**
+	\file systime.hpp
+	Timestamps of real-time events (received MIDI bytes, audio block boundaries)
+	based on the DWT cycle counter. Unlike profiler_timestamp( ), on the host this
+	is simulated time advanced by host_sim, so offline renders stay deterministic.
+
+	The counter wraps around every ~25 s at 168 MHz, so only differences between
+	recent timestamps are meaningful.
+*/
+
+//! Starts the cycle counter (doesn't reset it if it's already running)
+static inline void systime_init( )
+{
+#ifndef SYNTH_HOST
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+//! Returns current time in CPU cycles
+static inline uint32_t systime_now( )
+{
+	return DWT->CYCCNT;
+}
+
+//! Returns number of systime_now( ) ticks per second
+static inline uint32_t systime_ticks_per_second( )
+{
+	return SystemCoreClock;
+}
+
+#endif
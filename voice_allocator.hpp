@@ -0,0 +1,267 @@
+#ifndef VOICE_ALLOCATOR_HPP
+#define VOICE_ALLOCATOR_HPP
+
+#include <cstdint>
+#include <cmath>
+#include <stdexcept>
+
+/**
+	\file voice_allocator.hpp
+	Fixed-capacity voice allocator with O(1) note on and note off.
+
+	Every voice is linked into one of three intrusive doubly-linked lists built from
+	indices in fixed arrays - idle (silent) voices, released voices (note off, but
+	still sounding) in the order they were released and busy voices in the order
+	they were started. A new note gets the voice which has been idle for the longest
+	time, then a released one and only then steals a busy one.
+
+	Without levels, released voices never go idle and the oldest released voice is
+	taken. Once output levels of the voices are passed to set_levels( ) (e.g. envelope
+	levels exported by the DSP), released voices become idle when they fall silent
+	and the quietest released voice is taken if it's below click_level - that costs
+	a scan of at most N levels, but only when there's no idle voice. If all released
+	voices are louder, the note clicks anyway, so the oldest one is taken - always
+	taking the quietest one would use up voices about to fall below click_level and
+	make more of the following notes click. Busy voices are stolen the same way - a held
+	note can have decayed below click_level too (e.g. a plucked sound), but a note started
+	since the last levels were passed is considered loud, as its level isn't known yet.
+	Nothing is allocated after construction.
+*/
+
+/**
+	\brief Assigns MIDI keys to at most N voices
+*/
+template <int N>
+class voice_allocator
+{
+	static_assert( N > 0 && N < 128, "voice indices have to fit in int8_t" );
+
+public:
+	//! Max number of voices
+	static constexpr int capacity = N;
+
+	//! Level below which a released voice is considered silent (-80 dB)
+	static constexpr float silence_level = 1e-4f;
+
+	//! Level below which a released voice can be taken without an audible click (-40 dB)
+	static constexpr float click_level = 0.01f;
+
+	explicit voice_allocator( int voices = N ) :
+		m_voices( voices )
+	{
+		if ( voices < 1 || voices > N )
+			throw std::runtime_error( "invalid number of voices" );
+		reset( );
+	}
+
+	//! Makes all voices idle (in order of their numbers) and forgets all keys
+	void reset( )
+	{
+		for ( auto &v : m_key_voice ) v = -1;
+		m_idle = m_released = m_busy = list( );
+		for ( int i = 0; i < m_voices; i++ )
+		{
+			m_voice_key[i] = -1;
+			m_level[i] = 0;
+			m_is_idle[i] = true;
+			push_back( m_idle, i );
+		}
+	}
+
+	/**
+		Assigns a voice to key (0-127) and returns its number. If the key is already
+		playing, its voice is released first. If there are no idle or released voices,
+		a busy one is taken away from its key (see quietest( )).
+	*/
+	int note_on( int key )
+	{
+		note_off( key );
+
+		int id;
+		if ( m_idle.head >= 0 )
+		{
+			id = m_idle.head;
+			remove( m_idle, id );
+		}
+		else if ( m_released.head >= 0 )
+		{
+			id = quietest( m_released );
+			remove( m_released, id );
+		}
+		else
+		{
+			id = quietest( m_busy );
+			remove( m_busy, id );
+			m_key_voice[m_voice_key[id]] = -1;
+		}
+
+		// Until the next levels, the new note is considered loud
+		m_level[id] = INFINITY;
+		push_back( m_busy, id );
+		m_is_idle[id] = false;
+		m_voice_key[id] = key;
+		m_key_voice[key] = id;
+		return id;
+	}
+
+	//! Releases voice playing key (0-127) and returns its number or -1 if the key isn't playing
+	int note_off( int key )
+	{
+		int id = m_key_voice[key];
+		if ( id < 0 ) return -1;
+
+		m_key_voice[key] = -1;
+		m_voice_key[id] = -1;
+		remove( m_busy, id );
+		push_back( m_released, id );
+		return id;
+	}
+
+	/**
+		Updates output levels of all voices. Released voices which have fallen below
+		silence_level become idle. From now on, the quietest released voice is taken
+		first if it's below click_level.
+	*/
+	void set_levels( const float *levels )
+	{
+		m_has_levels = true;
+		for ( int i = 0; i < m_voices; i++ )
+			m_level[i] = std::fabs( levels[i] );
+
+		for ( int id = m_released.head, next; id >= 0; id = next )
+		{
+			next = m_next[id];
+			if ( m_level[id] < silence_level )
+			{
+				remove( m_released, id );
+				push_back( m_idle, id );
+				m_is_idle[id] = true;
+			}
+		}
+	}
+
+	//! Voice playing key or -1
+	int get_voice( int key ) const
+	{
+		return m_key_voice[key];
+	}
+
+	//! Key played by voice or -1
+	int get_key( int voice ) const
+	{
+		return m_voice_key[voice];
+	}
+
+	//! Returns true if voice is playing a key or still sounding after note off
+	bool is_active( int voice ) const
+	{
+		return !m_is_idle[voice];
+	}
+
+	//! Number of voices
+	int size( ) const
+	{
+		return m_voices;
+	}
+
+	/**
+		Checks internal consistency - every voice is in exactly one list, busy voices
+		and keys map onto each other both ways and idle or released voices have no key.
+		Only meant for tests.
+	*/
+	bool check_invariants( ) const
+	{
+		int in_list[N] = {0};
+		int idle = walk( m_idle, in_list ), released = walk( m_released, in_list ), busy = walk( m_busy, in_list );
+		if ( idle < 0 || released < 0 || busy < 0 || idle + released + busy != m_voices ) return false;
+
+		for ( int i = 0; i < m_voices; i++ )
+		{
+			if ( in_list[i] != 1 ) return false;
+			int key = m_voice_key[i];
+			if ( key >= 0 && m_key_voice[key] != i ) return false;
+		}
+
+		int mapped = 0;
+		for ( int key = 0; key < 128; key++ )
+		{
+			int id = m_key_voice[key];
+			if ( id < 0 ) continue;
+			if ( id >= m_voices || m_voice_key[id] != key ) return false;
+			mapped++;
+		}
+
+		// Only busy voices play keys
+		for ( int id = m_idle.head; id >= 0; id = m_next[id] )
+			if ( m_voice_key[id] >= 0 || !m_is_idle[id] ) return false;
+		for ( int id = m_released.head; id >= 0; id = m_next[id] )
+			if ( m_voice_key[id] >= 0 || m_is_idle[id] ) return false;
+		for ( int id = m_busy.head; id >= 0; id = m_next[id] )
+			if ( m_is_idle[id] ) return false;
+		return mapped == busy;
+	}
+
+private:
+	//! Ends of a voice list (-1 if empty)
+	struct list
+	{
+		int8_t head = -1;
+		int8_t tail = -1;
+	};
+
+	/**
+		The quietest voice in a non-empty list if it's below click_level, otherwise
+		the oldest one (also without levels or on a tie)
+	*/
+	int quietest( const list &l ) const
+	{
+		int best = l.head;
+		if ( m_has_levels )
+			for ( int id = m_next[best]; id >= 0; id = m_next[id] )
+				if ( m_level[id] < m_level[best] ) best = id;
+		return m_level[best] < click_level ? best : l.head;
+	}
+
+	void push_back( list &l, int id )
+	{
+		m_prev[id] = l.tail;
+		m_next[id] = -1;
+		if ( l.tail >= 0 ) m_next[l.tail] = id;
+		else l.head = id;
+		l.tail = id;
+	}
+
+	void remove( list &l, int id )
+	{
+		if ( m_prev[id] >= 0 ) m_next[m_prev[id]] = m_next[id];
+		else l.head = m_next[id];
+		if ( m_next[id] >= 0 ) m_prev[m_next[id]] = m_prev[id];
+		else l.tail = m_prev[id];
+	}
+
+	//! Counts list elements into count[] and returns list length or -1 if the links are broken
+	int walk( const list &l, int *count ) const
+	{
+		int n = 0, prev = -1;
+		for ( int id = l.head; id >= 0; prev = id, id = m_next[id] )
+		{
+			if ( id >= m_voices || m_prev[id] != prev || ++n > m_voices ) return -1;
+			count[id]++;
+		}
+		return prev == l.tail ? n : -1;
+	}
+
+	int m_voices;
+	list m_idle;               //!< Idle voices, the longest idle first
+	list m_released;           //!< Released voices, the first released first
+	list m_busy;               //!< Busy voices, the oldest first
+	bool m_has_levels = false; //!< Levels have been set
+	float m_level[N];          //!< Last output level of each voice
+	bool m_is_idle[N];         //!< Voice is in the idle list
+	int8_t m_next[N];
+	int8_t m_prev[N];
+	int8_t m_voice_key[N];     //!< Key played by each voice, -1 if idle
+	int8_t m_key_voice[128];   //!< Voice playing each key, -1 if none
+};
+
+#endif
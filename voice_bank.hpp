@@ -0,0 +1,176 @@
+#ifndef VOICE_BANK_HPP
+#define VOICE_BANK_HPP
+
+#include <vector>
+#include <memory>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <faust_dsp.hpp>
+
+/**
+	\file voice_bank.hpp
+	Polyphony by instancing a monophonic voice DSP.
+
+	Voice 0 is the DSP passed to the bank, the other voices are its clones. Only
+	active voices are computed - the first one straight into the output and the
+	others into a scratch buffer which is then mixed into the output - so the cost
+	scales with the number of notes actually sounding, not with the number of voices.
+
+	Controls shared by all voices (e.g. knobs) are only set on voice 0. Their values
+	are copied into each voice right before it's computed.
+
+	A voice which is no longer active is still computed until its output has stayed
+	below the sleep level for the hold time, so release and effect tails aren't cut
+	short by a voice going idle a bit early. Then it sleeps - it isn't computed at
+	all - and its state is cleared when it becomes active again. Voices start awake,
+	so an inactive voice is computed for the hold time first too.
+*/
+
+//! Adds count samples of src to dst
+static inline void voice_mix( float *__restrict dst, const float *__restrict src, int count )
+{
+	for ( int i = 0; i < count; i++ )
+		dst[i] += src[i];
+}
+
+//! Returns the largest absolute value among count samples
+static inline float voice_peak( const float *src, int count )
+{
+	float peak = 0;
+	for ( int i = 0; i < count; i++ )
+		peak = std::fmax( peak, std::fabs( src[i] ) );
+	return peak;
+}
+
+/**
+	\brief A number of instances of one DSP, computed only when active and mixed together
+*/
+class voice_bank
+{
+public:
+	/**
+		Creates a bank of voices instances of dsp with control_count controls each
+		(in the order of generated control tables). Controls for which shared[i] is
+		set follow voice 0. Blocks up to max_count samples long can be computed.
+	*/
+	voice_bank( faust_dsp &dsp, int voices, const bool *shared, int control_count, int max_count ) :
+		m_dsp( dsp ),
+		m_control_count( control_count ),
+		m_zones( voices * control_count + 1 ),
+		m_peaks( voices, 0.f ),
+		m_quiet( voices, 0 ),
+		m_asleep( voices, false ),
+		m_scratch( voices > 1 ? max_count : 0 )
+	{
+		if ( voices < 1 )
+			throw std::runtime_error( "voice bank needs at least one voice" );
+		if ( dsp.get_output_count( ) != 1 )
+			throw std::runtime_error( "voice DSP must have exactly 1 output" );
+
+		dsp.get_zones( m_zones.data( ), control_count );
+		for ( int i = 1; i < voices; i++ )
+		{
+			m_clones.push_back( dsp.clone( ) );
+			if ( m_clones.back( )->init_zones( m_zones.data( ) + i * control_count, control_count ) != control_count )
+				throw std::runtime_error( "DSP controls don't match the generated control table" );
+		}
+
+		for ( int i = 0; i < control_count; i++ )
+			if ( shared[i] )
+				m_shared.push_back( i );
+	}
+
+	/**
+		Inactive voices sleep once their output peak has been below level for hold
+		samples. Level 0 keeps them awake forever. By default they sleep as soon as
+		they're inactive.
+	*/
+	void set_sleep( float level, int hold )
+	{
+		m_sleep_level = level;
+		m_sleep_hold = hold;
+	}
+
+	//! Number of voices
+	int size( ) const
+	{
+		return m_peaks.size( );
+	}
+
+	//! Pointer to value of control (index in the generated control table) of a voice
+	float *get_zone( int voice, int control ) const
+	{
+		return m_zones[voice * m_control_count + control];
+	}
+
+	//! Peak output of a voice in the last block it was computed in
+	const float &get_peak( int voice ) const
+	{
+		return m_peaks[voice];
+	}
+
+	/**
+		Computes count samples of voices for which active[voice] is set (and of inactive
+		ones which aren't asleep yet) and writes their sum to output (silence if there are
+		none). Returns number of computed voices.
+	*/
+	int compute( int count, float **inputs, float *output, const bool *active )
+	{
+		int computed = 0;
+		for ( int v = 0; v < size( ); v++ )
+		{
+			if ( !active[v] && ( m_asleep[v] || ( m_sleep_level > 0 && m_quiet[v] >= m_sleep_hold ) ) )
+			{
+				m_asleep[v] = true;
+				m_peaks[v] = 0;
+				continue;
+			}
+
+			// Waking up - whatever was left in the voice is inaudible anyway
+			if ( m_asleep[v] )
+			{
+				if ( v ) m_clones[v - 1]->instanceClear( );
+				else m_dsp.clear( );
+				m_asleep[v] = false;
+				m_quiet[v] = 0;
+			}
+
+			// Shared controls follow voice 0
+			float **zones = m_zones.data( ) + v * m_control_count;
+			if ( v )
+				for ( int i : m_shared )
+					*zones[i] = *m_zones[i];
+
+			float *dst = computed ? m_scratch.data( ) : output;
+			if ( v ) m_clones[v - 1]->compute( count, inputs, &dst );
+			else m_dsp.compute( count, inputs, &dst );
+			m_peaks[v] = voice_peak( dst, count );
+			m_quiet[v] = m_peaks[v] < m_sleep_level ? std::min( m_quiet[v] + count, m_sleep_hold ) : 0;
+
+			if ( computed )
+				voice_mix( output, dst, count );
+			computed++;
+		}
+
+		if ( !computed )
+			for ( int i = 0; i < count; i++ )
+				output[i] = 0;
+		return computed;
+	}
+
+private:
+	faust_dsp &m_dsp;
+	std::vector<std::unique_ptr<faust_dsp_base>> m_clones;
+	int m_control_count;
+	std::vector<float*> m_zones;  //!< Control value pointers of all voices (one spare, so it's never empty)
+	std::vector<int> m_shared;    //!< Indices of shared controls
+	std::vector<float> m_peaks;
+	std::vector<int> m_quiet;     //!< Number of samples (up to m_sleep_hold) each voice has been quiet for
+	std::vector<bool> m_asleep;
+	std::vector<float> m_scratch;
+	float m_sleep_level = INFINITY;
+	int m_sleep_hold = 0;
+};
+
+#endif